@@ -6,7 +6,6 @@
 #include "Components/StaticMeshComponent.h"
 #include "Engine/StaticMesh.h"
 #include "Materials/MaterialInstance.h"
-#include <random>
 
 const float ADefrostPuzzleBlock::BlockSize = 10.f;
 
@@ -27,6 +26,7 @@ ADefrostPuzzleBlock::ADefrostPuzzleBlock()
 		ConstructorHelpers::FObjectFinderOptional<UMaterialInstance> FrozenMaterial;
 		ConstructorHelpers::FObjectFinderOptional<UMaterialInstance> HardFrozenMaterial;
 		ConstructorHelpers::FObjectFinderOptional<UMaterialInstance> MeltedMaterial;
+		ConstructorHelpers::FObjectFinderOptional<UMaterialInstance> CrackedMaterial;
 		ConstructorHelpers::FObjectFinderOptional<UMaterialInstance> BlueMaterial;
 		ConstructorHelpers::FObjectFinderOptional<UMaterialInstance> OrangeMaterial;
 		FConstructorStatics()
@@ -42,6 +42,7 @@ ADefrostPuzzleBlock::ADefrostPuzzleBlock()
 			, FrozenMaterial(TEXT("/Game/Puzzle/Meshes/MI_CubeFrozen.MI_CubeFrozen"))
 			, HardFrozenMaterial(TEXT("/Game/Puzzle/Meshes/MI_CubeFrozen.MI_CubeFrozen"))
 			, MeltedMaterial(TEXT("/Game/Puzzle/Meshes/MI_CubeOrange.MI_CubeOrange"))
+			, CrackedMaterial(TEXT("/Game/Puzzle/Meshes/MI_CubeRock.MI_CubeRock"))
 			, BlueMaterial(TEXT("/Game/Puzzle/Meshes/MI_CubeBlue.MI_CubeBlue"))
 			, OrangeMaterial(TEXT("/Game/Puzzle/Meshes/MI_CubeOrange.MI_CubeOrange"))
 		{
@@ -74,6 +75,7 @@ ADefrostPuzzleBlock::ADefrostPuzzleBlock()
 	FrozenMaterial = ConstructorStatics.FrozenMaterial.Get();
 	HardFrozenMaterial = ConstructorStatics.HardFrozenMaterial.Get();
 	MeltedMaterial = ConstructorStatics.MeltedMaterial.Get();
+	CrackedMaterial = ConstructorStatics.CrackedMaterial.Get();
 
 	RockMeshs.Add(ConstructorStatics.RockMeshA.Get());
 	RockMeshs.Add(ConstructorStatics.RockMeshB.Get());
@@ -81,6 +83,8 @@ ADefrostPuzzleBlock::ADefrostPuzzleBlock()
 	RockMeshs.Add(ConstructorStatics.RockMeshD.Get());
 	RockMeshs.Add(ConstructorStatics.RockMeshE.Get());
 	RockMeshs.Add(ConstructorStatics.RockMeshF.Get());
+
+	Cell = game::InvalidCellIndex;
 }
 
 void ADefrostPuzzleBlock::BlockClicked(UPrimitiveComponent* ClickedComp, FKey ButtonClicked)
@@ -104,18 +108,16 @@ void ADefrostPuzzleBlock::SetBlockType(const EBlockType Type)
 		FrozenMaterial,		// Frozen
 		HardFrozenMaterial,	// HardFrozen
 		MeltedMaterial,		// Melted
+		CrackedMaterial,	// Cracked
 	};
 
 	// Change material
 	BlockMesh->SetMaterial(0, TypeToMaterial[static_cast<uint8>(Type)]);
 }
 
-void ADefrostPuzzleBlock::ChangeRockMesh()
+void ADefrostPuzzleBlock::ChangeRockMesh(const int32 Variation)
 {
-	std::mt19937 mt { std::random_device{}() };
-	std::uniform_int_distribution<int> r(0, RockMeshs.Num() - 1);
-
-	int rockIndex = r(mt);
+	const int32 rockIndex = FMath::Abs(Variation) % RockMeshs.Num();
 	float scales[] = { 0.014f, 0.025f, 0.025f, 0.015f, 0.016f, 0.015f };
 
 	BlockMesh->SetStaticMesh(RockMeshs[rockIndex]);
@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include "Game/CellIndex.h"
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "DefrostPuzzleBlock.generated.h"
@@ -13,6 +14,7 @@ enum class EBlockType : uint8
 	Frozen,
 	HardFrozen,
 	Melted,
+	Cracked,
 	Num  UMETA(Hidden)
 };
 
@@ -58,6 +60,10 @@ public:
 	UPROPERTY()
 	class UMaterialInstance* MeltedMaterial;
 
+	/** Pointer to material used on hard frozen blocks cracked by a piece */
+	UPROPERTY()
+	class UMaterialInstance* CrackedMaterial;
+
 	/** Pointer to blue material used on inactive blocks */
 	UPROPERTY()
 	class UMaterialInstance* BlueMaterial;
@@ -88,6 +94,9 @@ public:
 	UPROPERTY()
 	class ADefrostPuzzleBlockGrid* OwningGrid;
 
+	/** Cell of the grid this block is placed on */
+	game::CellIndex Cell;
+
 	/** Handle the block being clicked */
 	UFUNCTION()
 	void BlockClicked(UPrimitiveComponent* ClickedComp, FKey ButtonClicked);
@@ -100,8 +109,9 @@ public:
 	UFUNCTION()
 	void SetBlockType(const EBlockType BlockType);
 
+	/** Change to one of the rock meshes (Variation selects which one) */
 	UFUNCTION()
-	void ChangeRockMesh();
+	void ChangeRockMesh(const int32 Variation);
 
 	/** Get the block type */
 	UFUNCTION()
@@ -2,9 +2,14 @@
 
 #include "DefrostPuzzleBlockGrid.h"
 #include "DefrostPuzzleBlock.h"
+#include "DefrostPuzzleLevelSubsystem.h"
 #include "DefrostPuzzlePiece.h"
+#include "Game/Random.h"
 #include "Components/TextRenderComponent.h"
+#include "Engine/GameInstance.h"
 #include "Engine/World.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Paths.h"
 #include <functional>
 
 #define LOCTEXT_NAMESPACE "PuzzleBlockGrid"
@@ -30,6 +35,9 @@ ADefrostPuzzleBlockGrid::ADefrostPuzzleBlockGrid()
 	Width = 20;
 	Height = 20;
 	BlockSpacing = 300.f;
+	LevelSeed = 0;
+	LevelIndex = 0;
+	LevelPackDifficulty = -1;
 	PuzzleGoalPiece = nullptr;
 	Field = std::make_unique<game::Field>();
 	Sequence = std::make_unique<SequenceNop>(this);
@@ -37,18 +45,9 @@ ADefrostPuzzleBlockGrid::ADefrostPuzzleBlockGrid()
 
 void ADefrostPuzzleBlockGrid::UpdatePuzzlePiecesMesh()
 {
-	const float blockWidth = ADefrostPuzzleBlock::BlockSize, blockHeighg = ADefrostPuzzleBlock::BlockSize;
-	const int32 amountWidth = (Width * blockWidth) * .5f, amountHeight = (Height * blockHeighg) * .5f;
-
 	for (int index = 0; index < PuzzlePieces.Num(); ++index)
 	{
-		auto piece = PiecePositions[index];
-		const float XOffset = piece.x * BlockSpacing;
-		const float YOffset = piece.y * BlockSpacing;
-
-		const FVector PieceLocation = FVector(amountHeight - YOffset, -amountWidth + XOffset, ADefrostPuzzleBlock::BlockSize * .5f) + GetActorLocation();
-
-		PuzzlePieces[index]->SetActorLocation(PieceLocation);
+		PuzzlePieces[index]->SetActorLocation(GetCellLocation(GetPieceCell(index), ADefrostPuzzleBlock::BlockSize * .5f));
 	}
 }
 
@@ -56,71 +55,125 @@ void ADefrostPuzzleBlockGrid::BeginPlay()
 {
 	Super::BeginPlay();
 
-	game::Field::CreateParameter param;
-	param.width = Width;
-	param.height = Height;
-	Field->Create(param);
+	SeededParam.field.width = Width;
+	SeededParam.field.height = Height;
+	SeededParam.field.seed = LevelSeed != 0 ? static_cast<uint64>(LevelSeed) : FPlatformTime::Cycles64();
+	SeededParam.field.index = static_cast<uint64>(LevelIndex);
 
-	const float blockWidth = ADefrostPuzzleBlock::BlockSize, blockHeighg = ADefrostPuzzleBlock::BlockSize;
-	const int32 amountWidth = (Width * blockWidth) * .5f, amountHeight = (Height * blockHeighg) * .5f;
-
-	for (int32 y = 0; y < Height; ++y)
+	game::Random packRandom = game::Random(SeededParam.field.seed, SeededParam.field.index).Split(3);
+	if (!LevelPackPath.IsEmpty() && LoadLevelFromPack(packRandom))
 	{
-		for (int32 x = 0; x < Width; ++x)
-		{
-			const float XOffset = x * BlockSpacing;
-			const float YOffset = y * BlockSpacing;
+		Width = Field->GetWidth();
+		Height = Field->GetHeight();
+		StartLevel(SeededParam.field.seed, SeededParam.field.index);
+		return;
+	}
 
-			// Make position vector, offset from Grid location
-			const FVector BlockLocation = FVector(amountHeight - YOffset, -amountWidth + XOffset, 0.f) + GetActorLocation();
+	// 盤面ができるまでは読み込み中として、フレームごとに用意できたかを確かめる
+	ScoreText->SetText(LOCTEXT("Loading", "LOADING..."));
+	NextSequence<SequenceWaitLevel>();
+}
 
-			// Spawn a block
-			ADefrostPuzzleBlock* NewBlock = GetWorld()->SpawnActor<ADefrostPuzzleBlock>(BlockLocation, FRotator(0, 0, 0));
+bool ADefrostPuzzleBlockGrid::PrepareLevel(uint64& OutSeed, uint64& OutIndex)
+{
+	// シードの指定がなければ、裏で作って確かめておいた盤面を使う
+	UDefrostPuzzleLevelSubsystem* levelSubsystem = nullptr;
+	if (LevelSeed == 0 && GetGameInstance())
+	{
+		levelSubsystem = GetGameInstance()->GetSubsystem<UDefrostPuzzleLevelSubsystem>();
+	}
 
-			// Tell the block about its owner
-			if (NewBlock != nullptr)
-			{
-				NewBlock->OwningGrid = this;
-
-				switch (Field->GetCell(x, y))
-				{
-				case game::Field::CellType::Block:
-					NewBlock->ChangeRockMesh();
-					break;
-				case game::Field::CellType::Frozen:
-					NewBlock->SetBlockType(EBlockType::Frozen);
-					break;
-				case game::Field::CellType::HardFrozen:
-					NewBlock->SetBlockType(EBlockType::HardFrozen);
-					break;
-				}
-
-				if (auto* staticMesh = NewBlock->GetBlockMesh())
-				{
-					staticMesh->OnClicked.AddDynamic(this, &ADefrostPuzzleBlockGrid::BlockMeshClicked);
-					staticMesh->OnInputTouchBegin.AddDynamic(this, &ADefrostPuzzleBlockGrid::OnFingerPressedBlock);
-				}
-				PuzzleBlocks.Add(NewBlock);
-			}
+	if (levelSubsystem)
+	{
+		// ワーカーがいない環境では、このスレッドで候補を一つずつ確かめる
+		FDefrostPuzzleLevel level;
+		const bool bReady = levelSubsystem->HasWorkers()
+			? levelSubsystem->PopLevel(Width, Height, level)
+			: levelSubsystem->GenerateLevelStep(Width, Height, level);
+		if (!bReady || !level.CreateField(*Field))
+		{
+			return false;
 		}
+		OutSeed = level.Seed;
+		OutIndex = level.Index;
+		UE_LOG(LogTemp, Log, TEXT("Level %llu of seed %llu (%d moves)"), level.Index, level.Seed, level.MoveCount);
+		return true;
 	}
 
-	std::vector<game::Field::Position> pieces;
-	Field->PutPieces(pieces, 4);
-	PiecePositions.Reserve(pieces.size());
-	DefaultPiecePositions.Reserve(pieces.size());
-	for (auto& piece : pieces)
+	// シードを指定した盤面も同じ探索で解けることを確かめ、解けなければ次の番号の盤面にする
+	if (!SeededGenerator)
 	{
-		PiecePositions.Add(piece);
-		DefaultPiecePositions.Add(piece);
+		SeededGenerator = std::make_unique<game::LevelGenerator>();
+	}
+	game::LevelGenerator::Result result;
+	const bool bAccepted = SeededGenerator->Generate(SeededParam, *Field, result);
+	OutSeed = SeededParam.field.seed;
+	OutIndex = SeededParam.field.index++;
+	if (bAccepted)
+	{
+		SeededGenerator.reset();
+		UE_LOG(LogTemp, Log, TEXT("Level %llu of seed %llu (%d moves)"), OutIndex, OutSeed, result.moveCount);
 	}
+	return bAccepted;
+}
+
+void ADefrostPuzzleBlockGrid::StartLevel(const uint64 Seed, const uint64 Index)
+{
+	const std::vector<game::Field::Position> pieces = Field->GetPieces();
+	SetScore(0);
+
+	// 地形は書き換えずに共有し、ピースの位置と手数は GameState で持つ
+	Terrain = std::make_shared<const game::Terrain>(*Field);
+	Terrain->CreateState(pieces, InitialState);
+	State = InitialState;
+	Occupancy.Reset(Terrain->GetWidth() * Terrain->GetHeight());
+	Occupancy.Assign(State);
+	Melt.Reset(*Terrain);
+
+	// 岩の見た目は盤面とは別の系列から選ぶ（見た目を変えても盤面は変わらない）
+	game::Random rockRandom = game::Random(Seed, Index).Split(2);
+
+	Field->ForEachCell([&](const int32 x, const int32 y, const game::Field::CellType Cell)
+	{
+		// Make position vector, offset from Grid location
+		const game::CellIndex BlockCell = game::MakeCellIndex(x, y, Width);
+		const FVector BlockLocation = GetCellLocation(BlockCell, 0.f);
+
+		// Spawn a block
+		ADefrostPuzzleBlock* NewBlock = GetWorld()->SpawnActor<ADefrostPuzzleBlock>(BlockLocation, FRotator(0, 0, 0));
+
+		// Tell the block about its owner
+		if (NewBlock != nullptr)
+		{
+			NewBlock->OwningGrid = this;
+			NewBlock->Cell = BlockCell;
+
+			switch (Cell)
+			{
+			case game::Field::CellType::Block:
+				NewBlock->ChangeRockMesh(static_cast<int32>(rockRandom.Below(0x7fffffff)));
+				break;
+			case game::Field::CellType::Frozen:
+			case game::Field::CellType::Piece:
+				NewBlock->SetBlockType(EBlockType::Frozen);
+				break;
+			case game::Field::CellType::HardFrozen:
+				NewBlock->SetBlockType(EBlockType::HardFrozen);
+				break;
+			}
+
+			if (auto* staticMesh = NewBlock->GetBlockMesh())
+			{
+				staticMesh->OnClicked.AddDynamic(this, &ADefrostPuzzleBlockGrid::BlockMeshClicked);
+				staticMesh->OnInputTouchBegin.AddDynamic(this, &ADefrostPuzzleBlockGrid::OnFingerPressedBlock);
+			}
+			PuzzleBlocks.Add(NewBlock);
+		}
+	});
 
 	// Spawn Pieces
-	for (auto& piece : PiecePositions)
+	for (int32 index = 0; index < InitialState.pieceNum; ++index)
 	{
-		const float XOffset = piece.x * BlockSpacing;
-		const float YOffset = piece.y * BlockSpacing;
-		
 		ADefrostPuzzlePiece* NewPiece = GetWorld()->SpawnActor<ADefrostPuzzlePiece>(FVector::ZeroVector, FRotator(0, 0, 0));
 		NewPiece->SetPieceType(EPieceType::Sub);
 		PuzzlePieces.Add(NewPiece);
@@ -129,30 +182,25 @@ void ADefrostPuzzleBlockGrid::BeginPlay()
 		{
 			staticMesh->OnClicked.AddDynamic(this, &ADefrostPuzzleBlockGrid::PieceMeshClicked);
 		}
-		const FVector PieceLocation = FVector(amountHeight - YOffset, -amountWidth + XOffset, ADefrostPuzzleBlock::BlockSize * .5f) + GetActorLocation();
-		NewPiece->SetActorLocation(PieceLocation);
+		NewPiece->SetActorLocation(GetCellLocation(InitialState.pieces[index], ADefrostPuzzleBlock::BlockSize * .5f));
 	}
 	PuzzlePieces[0]->SetPieceType(EPieceType::Main);
 
-	auto goalPos = Field->GetGoalPosition();
 	PuzzleGoalPiece = GetWorld()->SpawnActor<ADefrostPuzzlePiece>(
-		FVector(amountHeight - (goalPos.y * BlockSpacing), -amountWidth + (goalPos.x * BlockSpacing), ADefrostPuzzleBlock::BlockSize * 0.5f) + GetActorLocation(), 
+		GetCellLocation(Terrain->GetGoalCell(), ADefrostPuzzleBlock::BlockSize * 0.5f),
 		FRotator(0, 90, 0));
 	PuzzleGoalPiece->SetPieceType(EPieceType::Goal);
 	PuzzleGoalPiece->SetChildIdle(true);
 
-	Field->Dump([&](const game::Field::CellType** cells, const int width, const int height)
+	for (const auto row : Field->Rows())
 	{
-		for (int y = 0; y < height; ++y)
+		TStringBuilder<256> builder;
+		for (const auto cell : row)
 		{
-			TStringBuilder<256> builder;
-			for (int x = 0; x < width; ++x)
-			{
-				builder.Append('0' + static_cast<uint8_t>(cells[y][x]));
-			}
-			UE_LOG(LogTemp, Log, TEXT("%s"), builder.ToString());
+			builder.Append('0' + static_cast<uint8_t>(cell));
 		}
-	});
+		UE_LOG(LogTemp, Log, TEXT("%s"), builder.ToString());
+	}
 
 #if 0
 	// Number of blocks
@@ -179,6 +227,53 @@ void ADefrostPuzzleBlockGrid::BeginPlay()
 #endif
 }
 
+bool ADefrostPuzzleBlockGrid::LoadLevelFromPack(game::Random& Random)
+{
+	if (!LevelPack.IsOpen())
+	{
+		const FString Path = FPaths::IsRelative(LevelPackPath) ? FPaths::Combine(FPaths::ProjectContentDir(), LevelPackPath) : LevelPackPath;
+
+		// パックは読み込まずに割り当てるだけなので、開く時間はパックの大きさによらない
+		LevelPackFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Path));
+		if (LevelPackFile)
+		{
+			LevelPackRegion.Reset(LevelPackFile->MapRegion());
+		}
+		if (!LevelPackRegion || !LevelPack.Open(LevelPackRegion->GetMappedPtr(), static_cast<size_t>(LevelPackRegion->GetMappedSize())))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Failed to open level pack %s"), *Path);
+			LevelPackRegion.Reset();
+			LevelPackFile.Reset();
+			return false;
+		}
+	}
+
+	uint32 Level = 0;
+	if (LevelPackDifficulty >= 0)
+	{
+		if (!LevelPack.PickLevel(static_cast<uint32>(LevelPackDifficulty), Random, Level))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Level pack has no level of difficulty %d"), LevelPackDifficulty);
+			return false;
+		}
+	}
+	else if (LevelPack.GetLevelNum() > 0)
+	{
+		Level = Random.Below(LevelPack.GetLevelNum());
+	}
+
+	// ピースが 4 つの盤面しか扱えない
+	if (!LevelPack.Load(Level, *Field) || Field->GetPieces().size() != 4)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to load level %u from level pack"), Level);
+		return false;
+	}
+
+	const auto& Entry = LevelPack.GetEntry(Level);
+	UE_LOG(LogTemp, Log, TEXT("Level %u from pack (%d moves, seed %llu index %llu)"), Level, Entry.moveCount, Entry.seed, Entry.index);
+	return true;
+}
+
 void ADefrostPuzzleBlockGrid::Tick(float DeltaSeconds)
 {
 	Super::Tick(DeltaSeconds);
@@ -235,49 +330,9 @@ int32 ADefrostPuzzleBlockGrid::GetScore() const
 	return Score;
 }
 
-ADefrostPuzzleBlock* ADefrostPuzzleBlockGrid::GetPuzzleBlock(const int x, const int y)
-{
-	const int32 index = (y * Width) + x;
-	return PuzzleBlocks[index];
-}
-
-ADefrostPuzzleBlock* ADefrostPuzzleBlockGrid::GetPuzzleBlock(const int index)
-{
-	return PuzzleBlocks[index];
-}
-
-int32 ADefrostPuzzleBlockGrid::GetPuzzleBlockIndex(const ADefrostPuzzleBlock* Block) const
+ADefrostPuzzleBlock* ADefrostPuzzleBlockGrid::GetPuzzleBlock(const game::CellIndex Cell)
 {
-	for (int32 index = 0, size = Height * Width; index < size; ++index)
-	{
-		if (PuzzleBlocks[index] == Block)
-		{
-			return index;
-		}
-	}
-	return -1;
-}
-
-std::pair<int32, int32> ADefrostPuzzleBlockGrid::GetPuzzleBlockPosition(const ADefrostPuzzleBlock* Block) const
-{
-	for (int32 y = 0; y < Height; ++y)
-	{
-		for (int32 x = 0; x < Width; ++x)
-		{
-			const int32 index = (y * Width) + x;
-
-			if (PuzzleBlocks[index] == Block)
-			{
-				return std::pair<int32, int32>(x, y);
-			}
-		}
-	}
-	return std::pair<int32, int32>(-1, -1);
-}
-
-std::pair<int32, int32> ADefrostPuzzleBlockGrid::GetPuzzlePiecePositionByIndex(const int PieceIndex) const
-{
-	return std::pair<int32, int32>(PiecePositions[PieceIndex].x, PiecePositions[PieceIndex].y);
+	return PuzzleBlocks[Cell];
 }
 
 int ADefrostPuzzleBlockGrid::GetPuzzlePieceIndex(const ADefrostPuzzlePiece* Piece) const
@@ -292,18 +347,21 @@ int ADefrostPuzzleBlockGrid::GetPuzzlePieceIndex(const ADefrostPuzzlePiece* Piec
 	return -1;
 }
 
-const TArray<game::Field::Position>& ADefrostPuzzleBlockGrid::GetPieces() const
+game::CellIndex ADefrostPuzzleBlockGrid::GetPieceCell(const int PieceIndex) const
 {
-	return PiecePositions;
+	return State.pieces[PieceIndex];
+}
+
+game::PieceSet ADefrostPuzzleBlockGrid::GetPieces() const
+{
+	return State.PackPieces();
 }
 
 void ADefrostPuzzleBlockGrid::SetHighlightBlock(const int PieceIndex)
 {
-	auto& piece = PiecePositions[PieceIndex];
-	
 	ResetHighlightAll();
 
-	if (auto* block = GetPuzzleBlock(piece.x, piece.y))
+	if (auto* block = GetPuzzleBlock(GetPieceCell(PieceIndex)))
 	{
 		block->Highlight(true);
 	}	
@@ -311,13 +369,13 @@ void ADefrostPuzzleBlockGrid::SetHighlightBlock(const int PieceIndex)
 
 int ADefrostPuzzleBlockGrid::SetHighlightDirection(const int PieceIndex, const EPuzzleDirection Direction)
 {
-	if (PiecePositions.Num() <= PieceIndex)
+	if (State.pieceNum <= PieceIndex)
 	{
 		return 0;
 	}
 
 #if 0
-	auto start = PiecePositions[PieceIndex];
+	auto start = Terrain->GetPosition(GetPieceCell(PieceIndex));
 	std::function<bool(int, int)> checkDirection[] =
 	{
 		[&start](const int px, const int py)
@@ -356,8 +414,7 @@ int ADefrostPuzzleBlockGrid::SetHighlightDirection(const int PieceIndex, const E
 	ResetHighlightAll();
 
 	std::vector<ADefrostPuzzleBlock*> blocks;
-	bool isGoal = false;
-	ADefrostPuzzleBlockGrid::GetPuzzleBlockLine(PieceIndex, Direction, blocks, isGoal);
+	ADefrostPuzzleBlockGrid::GetPuzzleBlockLine(PieceIndex, Direction, blocks);
 
 	for (auto& block : blocks)
 	{
@@ -390,84 +447,98 @@ void ADefrostPuzzleBlockGrid::SetPieceDirection(const int PieceIndex, const EPuz
 	PuzzlePieces[PieceIndex]->SetActorRotation(FQuat::MakeFromEuler(FVector(0, 0, eulerZ[static_cast<int8>(Direction)])));
 }
 
-void ADefrostPuzzleBlockGrid::SetPiecePosition(const int PieceIndex, const std::pair<int32, int32> Position)
+void ADefrostPuzzleBlockGrid::SetPieces(const game::PieceSet Pieces, const int32 MoveCount)
 {
-	PiecePositions[PieceIndex] = game::Field::Position(std::get<0>(Position), std::get<1>(Position));
+	State.UnpackPieces(Pieces);
+	State.moveCount = static_cast<uint16>(MoveCount);
+	Occupancy.Assign(State);
+	SetScore(State.moveCount);
 }
 
-bool ADefrostPuzzleBlockGrid::MovePiece(const int PieceIndex, const EPuzzleDirection Direction)
+void ADefrostPuzzleBlockGrid::UndoMove(const game::PieceSet Pieces, const int32 MoveCount)
 {
-	std::vector<ADefrostPuzzleBlock*> blocks;
-	bool isGoal = false;
-	auto pair = ADefrostPuzzleBlockGrid::GetPuzzleBlockLine(PieceIndex, Direction, blocks, isGoal);
-
-	auto target = game::Field::Position(std::get<0>(pair), std::get<1>(pair));
-
-	auto* sequence = NextSequence<SequenceMovePiece>();
-	sequence->SetTarget(PuzzlePieces[PieceIndex], PiecePositions[PieceIndex], target);
-	
-	PiecePositions[PieceIndex] = target;
+	SetPieces(Pieces, MoveCount);
+	ApplyMeltChanges(Melt.Undo());
+}
 
-	return (PieceIndex == 0) && isGoal;
+void ADefrostPuzzleBlockGrid::RedoMove(const int PieceIndex, const game::CellIndex FromCell, const game::PieceSet Pieces, const int32 MoveCount)
+{
+	SetPieces(Pieces, MoveCount);
+	ApplyMeltChanges(Melt.Step(FromCell, GetPieceCell(PieceIndex)));
 }
 
-void ADefrostPuzzleBlockGrid::ResetPieces()
+void ADefrostPuzzleBlockGrid::ApplyMeltChanges(const game::MeltSimulation::ChangeList& Changes)
 {
-	for (int index = 0; index < DefaultPiecePositions.Num(); ++index)
+	for (const auto& change : Changes)
 	{
-		PiecePositions[index] = DefaultPiecePositions[index];
+		switch (change.after)
+		{
+		case game::Field::CellType::Frozen:
+			PuzzleBlocks[change.cell]->SetBlockType(EBlockType::Frozen);
+			break;
+		case game::Field::CellType::HardFrozen:
+			PuzzleBlocks[change.cell]->SetBlockType(EBlockType::HardFrozen);
+			break;
+		case game::Field::CellType::Melted:
+			PuzzleBlocks[change.cell]->SetBlockType(EBlockType::Melted);
+			break;
+		case game::Field::CellType::Cracked:
+			PuzzleBlocks[change.cell]->SetBlockType(EBlockType::Cracked);
+			break;
+		default:
+			break;
+		}
 	}
 }
 
-bool ADefrostPuzzleBlockGrid::IsGoal(const int Index) const
+bool ADefrostPuzzleBlockGrid::MovePiece(const int PieceIndex, const EPuzzleDirection Direction)
 {
-	return Field->GetCell(Index % Width, Index / Width) == game::Field::CellType::Goal;
+	const game::CellIndex from = GetPieceCell(PieceIndex);
+	Terrain->Move(State, Occupancy, PieceIndex, static_cast<game::Field::Direction>(Direction));
+	SetScore(State.moveCount);
+	ApplyMeltChanges(Melt.Step(from, GetPieceCell(PieceIndex)));
+
+	auto* sequence = NextSequence<SequenceMovePiece>();
+	sequence->SetTarget(PuzzlePieces[PieceIndex], GetPieceCell(PieceIndex));
+
+	return (PieceIndex == 0) && Terrain->IsCleared(State);
 }
 
-bool ADefrostPuzzleBlockGrid::CheckGoal(const game::Field::Position& Position) const
+void ADefrostPuzzleBlockGrid::ResetPieces()
 {
-	if (Position.x - 1 >= 0)
-	{
-		if (Field->GetCell(Position.x - 1, Position.y) == game::Field::CellType::Goal)
-		{
-			return true;
-		}
-	}
-
-	if (Position.x + 1 < Width)
+	// 盤面を用意している間は戻すものがない
+	if (!Terrain)
 	{
-		if (Field->GetCell(Position.x + 1, Position.y) == game::Field::CellType::Goal)
-		{
-			return true;
-		}
+		return;
 	}
 
-	if (Position.y - 1 >= 0)
-	{
-		if (Field->GetCell(Position.x, Position.y - 1) == game::Field::CellType::Goal)
-		{
-			return true;
-		}
-	}
+	State = InitialState;
+	Occupancy.Assign(State);
+	SetScore(State.moveCount);
+	ApplyMeltChanges(Melt.Rewind());
+}
 
-	if (Position.y + 1 < Height)
-	{
-		if (Field->GetCell(Position.x, Position.y + 1) == game::Field::CellType::Goal)
-		{
-			return true;
-		}
-	}
+bool ADefrostPuzzleBlockGrid::IsGoal(const game::CellIndex Cell) const
+{
+	return Terrain->GetCell(Cell) == game::Field::CellType::Goal;
+}
 
-	return Field->GetCell(Position.x, Position.y) == game::Field::CellType::Goal;
+bool ADefrostPuzzleBlockGrid::CheckGoal(const game::CellIndex Cell) const
+{
+	return Terrain->IsClearCell(Cell);
 }
 
 int ADefrostPuzzleBlockGrid::IsOnPiece(const class ADefrostPuzzleBlock* Block) const
 {
-	const auto& position = GetPuzzleBlockPosition(Block);
+	// ほとんどのブロックにはピースがいないので、ビット検査だけで返す
+	if (!Occupancy.Test(Block->Cell))
+	{
+		return -1;
+	}
 
-	for (int32 index = 0, size = PiecePositions.Num(); index < size; ++index)
+	for (int32 index = 0; index < State.pieceNum; ++index)
 	{
-		if (PiecePositions[index].x == std::get<0>(position) && PiecePositions[index].y == std::get<1>(position))
+		if (State.pieces[index] == Block->Cell)
 		{
 			return index;
 		}
@@ -486,89 +557,33 @@ void ADefrostPuzzleBlockGrid::AddListener(IDefrostPuzzleBlockGridListener* Liste
 	Listeners.AddUnique(Listener);
 }
 
-std::pair<int32, int32> ADefrostPuzzleBlockGrid::GetPuzzleBlockLine(const int PieceIndex, const EPuzzleDirection Direction, std::vector<class ADefrostPuzzleBlock*>& OutList, bool& OutIsGoal)
+FVector ADefrostPuzzleBlockGrid::GetCellLocation(const game::CellIndex Cell, const float Z) const
 {
-	auto start = PiecePositions[PieceIndex];
-
-	auto checkPieces = [&](const int px, const int py)
-	{
-		for (int32 index = 0; index < PiecePositions.Num(); ++index)
-		{
-			if (PieceIndex != index)
-			{
-				if (px == PiecePositions[index].x && py == PiecePositions[index].y)
-				{
-					return true;
-				}
-			}
-		}
-		return false;
-	};
-
-	switch (Direction)
-	{
-	case EPuzzleDirection::Up:
-		for (int32 y = start.y; y >= 0; --y)
-		{
-			const int32 index = (y * Width) + start.x;
-
-			OutIsGoal = IsGoal(index);
-			if (checkPieces(start.x, y) || PuzzleBlocks[index]->GetBlockType() != EBlockType::Frozen)
-			{
-				break;
-			}
-			start.y = y;
-			OutList.push_back(PuzzleBlocks[index]);
-		}
-		break;
-
-	case EPuzzleDirection::Down:
-		for (int32 y = start.y; y < Height; ++y)
-		{
-			const int32 index = (y * Width) + start.x;
-
-			OutIsGoal = IsGoal(index);
-			if (checkPieces(start.x, y) || PuzzleBlocks[index]->GetBlockType() != EBlockType::Frozen)
-			{
-				break;
-			}
-			start.y = y;
-			OutList.push_back(PuzzleBlocks[index]);
-		}
-		break;
+	const float blockWidth = ADefrostPuzzleBlock::BlockSize, blockHeighg = ADefrostPuzzleBlock::BlockSize;
+	const int32 amountWidth = (Width * blockWidth) * .5f, amountHeight = (Height * blockHeighg) * .5f;
 
-	case EPuzzleDirection::Left:
-		for (int32 x = start.x; x >= 0; --x)
-		{
-			const int32 index = (start.y * Width) + x;
+	const float XOffset = game::GetCellColumn(Cell, Width) * BlockSpacing;
+	const float YOffset = game::GetCellRow(Cell, Width) * BlockSpacing;
+	return FVector(amountHeight - YOffset, -amountWidth + XOffset, Z) + GetActorLocation();
+}
 
-			OutIsGoal = IsGoal(index);
-			if (checkPieces(x, start.y) || PuzzleBlocks[index]->GetBlockType() != EBlockType::Frozen)
-			{
-				break;
-			}
-			start.x = x;
-			OutList.push_back(PuzzleBlocks[index]);
-		}
-		break;
+game::CellIndex ADefrostPuzzleBlockGrid::GetPuzzleBlockLine(const int PieceIndex, const EPuzzleDirection Direction, std::vector<class ADefrostPuzzleBlock*>& OutList)
+{
+	// 止まる位置は Terrain で求め、今いるセルからそこまでのブロックを並べる（動けない場合は今いるセルだけ）
+	const game::CellIndex from = State.pieces[PieceIndex];
+	const game::CellIndex to = Terrain->Slide(State, Occupancy, PieceIndex, static_cast<game::Field::Direction>(Direction));
+	const int32 step = (to == from) ? 0 : ((Direction == EPuzzleDirection::Up || Direction == EPuzzleDirection::Down) ? Width : 1) * (to > from ? 1 : -1);
 
-	case EPuzzleDirection::Right:
-		for (int32 x = start.x; x < Width; ++x)
+	for (int32 index = from; ; index += step)
+	{
+		OutList.push_back(PuzzleBlocks[index]);
+		if (index == to)
 		{
-			const int32 index = (start.y * Width) + x;
-
-			OutIsGoal = IsGoal(index);
-			if (checkPieces(x, start.y) || PuzzleBlocks[index]->GetBlockType() != EBlockType::Frozen)
-			{
-				break;
-			}
-			start.x = x;
-			OutList.push_back(PuzzleBlocks[index]);
+			break;
 		}
-		break;
 	}
 
-	return std::pair<int, int>(start.x, start.y);
+	return to;
 }
 
 void ADefrostPuzzleBlockGrid::BlockMeshClicked(UPrimitiveComponent* ClickedComponent, FKey ButtonClicked)
@@ -577,7 +592,7 @@ void ADefrostPuzzleBlockGrid::BlockMeshClicked(UPrimitiveComponent* ClickedCompo
 
 	for (const auto& listener : Listeners)
 	{
-		listener->OnBlockMeshClicked(hitBlock, GetPuzzleBlockPosition(hitBlock), GetPuzzleBlockIndex(hitBlock));
+		listener->OnBlockMeshClicked(hitBlock, hitBlock->Cell);
 	}
 }
 
@@ -588,8 +603,7 @@ void ADefrostPuzzleBlockGrid::PieceMeshClicked(UPrimitiveComponent* ClickedCompo
 
 	for (const auto& listener : Listeners)
 	{
-		listener->OnPieceMeshClicked(hitPiece, std::pair<int32, int32>(
-			PiecePositions[hitIndex].x,PiecePositions[hitIndex].y), hitIndex);
+		listener->OnPieceMeshClicked(hitPiece, GetPieceCell(hitIndex), hitIndex);
 	}
 }
 
@@ -632,20 +646,13 @@ void ADefrostPuzzleBlockGrid::SequenceMovePiece::Update(float DeltaSeconds)
 	}
 }
 
-void ADefrostPuzzleBlockGrid::SequenceMovePiece::SetTarget(ADefrostPuzzlePiece* Piece, const game::Field::Position& Start, const game::Field::Position& Goal)
+void ADefrostPuzzleBlockGrid::SequenceMovePiece::SetTarget(ADefrostPuzzlePiece* Piece, const game::CellIndex Goal)
 {
-	const float blockWidth = ADefrostPuzzleBlock::BlockSize, blockHeighg = ADefrostPuzzleBlock::BlockSize;
-	const int32 amountWidth = (Owner->Width * blockWidth) * .5f, amountHeight = (Owner->Height * blockHeighg) * .5f;
-
 	TargetPiece = Piece;
 
 	StartPieceLocation = Piece->GetActorLocation();
 	
-	EndPieceLocation = FVector(
-		amountHeight - (Goal.y * Owner->BlockSpacing),
-		-amountWidth + (Goal.x * Owner->BlockSpacing),
-		ADefrostPuzzleBlock::BlockSize * .5f
-	) + Owner->GetActorLocation();
+	EndPieceLocation = Owner->GetCellLocation(Goal, ADefrostPuzzleBlock::BlockSize * .5f);
 
 	float distance = FVector::Distance(EndPieceLocation, StartPieceLocation);
 
@@ -709,6 +716,16 @@ void ADefrostPuzzleBlockGrid::SequenceMovePiece::Update_OutAnim(float DeltaSecon
 	}
 }
 
+void ADefrostPuzzleBlockGrid::SequenceWaitLevel::Update(float DeltaSeconds)
+{
+	uint64 seed = 0, index = 0;
+	if (Owner->PrepareLevel(seed, index))
+	{
+		Owner->StartLevel(seed, index);
+		Owner->NextSequence<SequenceNop>();
+	}
+}
+
 void ADefrostPuzzleBlockGrid::SequenceFinished::Update(float DeltaSeconds)
 {
 
@@ -3,8 +3,16 @@
 #pragma once
 
 #include <memory>
+#include "Game/CellIndex.h"
 #include "Game/Field.h"
+#include "Game/GameState.h"
+#include "Game/LevelGenerator.h"
+#include "Game/LevelPack.h"
+#include "Game/MeltSimulation.h"
+#include "Game/Occupancy.h"
+#include "Game/Terrain.h"
 #include "CoreMinimal.h"
+#include "Async/MappedFileHandle.h"
 #include "GameFramework/Actor.h"
 #include "DefrostPuzzleTypes.h"
 #include "DefrostPuzzleBlockGrid.generated.h"
@@ -13,8 +21,8 @@
 class IDefrostPuzzleBlockGridListener
 {
 public:
-	virtual void OnBlockMeshClicked(class ADefrostPuzzleBlock* ClickedBlock, const std::pair<int32, int32>& position, const int index) = 0;
-	virtual void OnPieceMeshClicked(class ADefrostPuzzlePiece* ClickedPiece, const std::pair<int32, int32>& position, const int index) = 0;
+	virtual void OnBlockMeshClicked(class ADefrostPuzzleBlock* ClickedBlock, const game::CellIndex Cell) = 0;
+	virtual void OnPieceMeshClicked(class ADefrostPuzzlePiece* ClickedPiece, const game::CellIndex Cell, const int PieceIndex) = 0;
 };
 
 /** Class used to spawn blocks and manage score */
@@ -49,6 +57,22 @@ public:
 	UPROPERTY(Category=Grid, EditAnywhere, BlueprintReadOnly)
 	float BlockSpacing;
 
+	/** Seed of the generated level (0 picks a new seed on every play) */
+	UPROPERTY(Category=Grid, EditAnywhere, BlueprintReadOnly)
+	int32 LevelSeed;
+
+	/** Index of the level within the seed */
+	UPROPERTY(Category=Grid, EditAnywhere, BlueprintReadOnly)
+	int32 LevelIndex;
+
+	/** Level pack to pick the level from, relative to the content directory (empty generates the level) */
+	UPROPERTY(Category=Grid, EditAnywhere, BlueprintReadOnly)
+	FString LevelPackPath;
+
+	/** Difficulty bucket of the level pack to pick from (-1 picks from all levels) */
+	UPROPERTY(Category=Grid, EditAnywhere, BlueprintReadOnly)
+	int32 LevelPackDifficulty;
+
 public:
 	UFUNCTION(BlueprintImplementableEvent, Category = Grid)
 	void OnGameFinished();
@@ -70,44 +94,41 @@ public:
 	void SetScore(const int NewScore);
 	int32 GetScore() const;
 
-	// w肳ꂽʒuix, yj̃ubN擾
-	class ADefrostPuzzleBlock* GetPuzzleBlock(const int x, const int y);
-	// w肳ꂽCfbNX̃ubN擾
-	class ADefrostPuzzleBlock* GetPuzzleBlock(const int index);
-	int32 GetPuzzleBlockIndex(const class ADefrostPuzzleBlock* Block) const;
-	// w肳ꂽubN̈ʒuix, yj擾
-	std::pair<int32, int32> GetPuzzleBlockPosition(const class ADefrostPuzzleBlock* Block) const;
-	// w肳ꂽs[Ẍʒuix, yj擾
-	std::pair<int32, int32> GetPuzzlePiecePositionByIndex(const int PieceIndex) const;
-	// w肳ꂽs[X̃CfbNX擾
+	// 指定されたセルのブロックを取得
+	class ADefrostPuzzleBlock* GetPuzzleBlock(const game::CellIndex Cell);
+	// 指定されたピースのインデックスを取得
 	int32 GetPuzzlePieceIndex(const class ADefrostPuzzlePiece* Piece) const;
-	// ׂẴs[X擾
-	const TArray<game::Field::Position>& GetPieces() const;
-	// w肳ꂽCfbNX̃s[XAw肳ꂽubNnCCgݒ
+	// 指定されたピースのセルを取得
+	game::CellIndex GetPieceCell(const int PieceIndex) const;
+	// 現在のピースの位置を 64bit に詰めて取得
+	game::PieceSet GetPieces() const;
+	// 指定されたインデックスのピースから、指定されたブロックをハイライトを設定
 	void SetHighlightBlock(const int PieceIndex);
-	// w肳ꂽCfbNX̃s[XAw肳ꂽ̃ubNɃnCCgݒ
+	// 指定されたインデックスのピースから、指定された方向のブロックにハイライトを設定
 	int SetHighlightDirection(const int PieceIndex, const EPuzzleDirection Direction);
-	// nCCgꂽubNׂăZbg
+	// ハイライトされたブロックをすべてリセット
 	void ResetHighlightAll();
-	// w肳ꂽCfbNX̃s[XAw肳ꂽɌ
+	// 指定されたインデックスのピースを、指定された方向に向く
 	void SetPieceDirection(const int PieceIndex, const EPuzzleDirection Direction);
-	// w肳ꂽs[Ẍʒuix, yjݒ
-	void SetPiecePosition(const int PieceIndex, const std::pair<int32, int32> Position);
-	// w肳ꂽCfbNX̃s[XAw肳ꂽɈړ
+	// ピースの位置と手数を一手前に戻し、その手で溶かしたブロックも戻す（アンドゥ）
+	void UndoMove(const game::PieceSet Pieces, const int32 MoveCount);
+	// 戻した手をやり直し、指定されたピースが FromCell から通ったブロックを溶かす（リドゥ）
+	void RedoMove(const int PieceIndex, const game::CellIndex FromCell, const game::PieceSet Pieces, const int32 MoveCount);
+	// 指定されたインデックスのピースを、指定された方向に移動
 	bool MovePiece(const int PieceIndex, const EPuzzleDirection Direction);
-	// ׂẴs[Xʒuɖ߂
+	// すべてのピースを初期位置に戻す
 	void ResetPieces();
-	// ׂẴs[Ẍʒu𔽉f
+	// すべてのピースの位置を反映
 	void UpdatePuzzlePiecesMesh();
-	// w肳ꂽCfbNXS[𔻒
-	bool IsGoal(const int Index) const;
-	// w肳ꂽCʒu̎͂ɃS[邩𔻒
-	bool CheckGoal(const game::Field::Position& Position) const;
-	// w肳ꂽubN̏Ƀs[XĂ邩𔻒
+	// 指定されたセルがゴールかを判定
+	bool IsGoal(const game::CellIndex Cell) const;
+	// 指定されたセルの周囲にゴールがあるかを判定
+	bool CheckGoal(const game::CellIndex Cell) const;
+	// 指定されたブロックの上にピースが乗っているかを判定
 	int IsOnPiece(const class ADefrostPuzzleBlock* Block) const;
-	// ݂\擾
+	// 現在が操作可能かを取得
 	bool CanPlayerControllable() const;
-	// Xi[ǉ
+	// リスナーを追加
 	void AddListener(IDefrostPuzzleBlockGridListener* Listener);
 
 	/** Returns DummyRoot subobject **/
@@ -116,8 +137,20 @@ public:
 	FORCEINLINE class UTextRenderComponent* GetScoreText() const { return ScoreText; }
 
 private:
-	// s[XzuĂʒuAw̃ubN擾AŏIʒuS[ɓBĂ邩fłi肾j
-	std::pair<int32, int32> GetPuzzleBlockLine(const int PieceIndex, const EPuzzleDirection Direction, std::vector<class ADefrostPuzzleBlock*>& OutList, bool &OutIsGoal);
+	// レベルパックから盤面を一つ選んで読み込む（パックは割り当てたまま保持する）
+	bool LoadLevelFromPack(game::Random& Random);
+	// 確かめ済みの盤面を一つ用意できたら Field に作って true を返す（ゲームスレッドを止めないよう、一回で判定する候補は一つまで）
+	bool PrepareLevel(uint64& OutSeed, uint64& OutIndex);
+	// Field の盤面からブロックとピースを配置して遊べるようにする
+	void StartLevel(const uint64 Seed, const uint64 Index);
+	// ピースの位置と手数を差し替える
+	void SetPieces(const game::PieceSet Pieces, const int32 MoveCount);
+	// 溶け具合が変わったブロックだけ見た目を変える
+	void ApplyMeltChanges(const game::MeltSimulation::ChangeList& Changes);
+	// セルの中心のワールド座標
+	FVector GetCellLocation(const game::CellIndex Cell, const float Z) const;
+	// ピースが配置されている位置から、指定方向に滑って止まる位置までのブロックを取得する（止まるセルを返す）
+	game::CellIndex GetPuzzleBlockLine(const int PieceIndex, const EPuzzleDirection Direction, std::vector<class ADefrostPuzzleBlock*>& OutList);
 	
 	UFUNCTION()
 	void BlockMeshClicked(UPrimitiveComponent* ClickedComponent, FKey ButtonClicked);
@@ -152,7 +185,7 @@ private:
 	public:
 		SequenceMovePiece(ADefrostPuzzleBlockGrid* Owner);
 		void Update(float DeltaSeconds) override;
-		void SetTarget(class ADefrostPuzzlePiece* Piece, const game::Field::Position& Start, const game::Field::Position& Goal);
+		void SetTarget(class ADefrostPuzzlePiece* Piece, const game::CellIndex Goal);
 		bool IsMoveEnd() const;
 
 	private:
@@ -177,6 +210,14 @@ private:
 		bool IsGoal;
 	};
 
+	// 盤面を用意できるまで毎フレーム PrepareLevel を試す（その間は操作できない）
+	class SequenceWaitLevel : public PuzzleBlockGridSequenceBase
+	{
+	public:
+		SequenceWaitLevel(ADefrostPuzzleBlockGrid* Owner) : PuzzleBlockGridSequenceBase(Owner) {}
+		void Update(float DeltaSeconds) override;
+	};
+
 	class SequenceFinished : public PuzzleBlockGridSequenceBase
 	{
 	public:
@@ -196,8 +237,16 @@ private:
 
 private:
 	std::unique_ptr<game::Field> Field;
-	TArray<game::Field::Position> PiecePositions;
-	TArray<game::Field::Position> DefaultPiecePositions;
+	TUniquePtr<IMappedFileHandle> LevelPackFile;
+	TUniquePtr<IMappedFileRegion> LevelPackRegion;
+	game::LevelPack LevelPack;
+	std::unique_ptr<game::LevelGenerator> SeededGenerator;	// シードを指定した盤面を確かめる（使うときだけ作る）
+	game::LevelGenerator::Parameter SeededParam;			// 次に確かめるシードと番号
+	std::shared_ptr<const game::Terrain> Terrain;
+	game::GameState State;
+	game::GameState InitialState;
+	game::Occupancy Occupancy;
+	game::MeltSimulation Melt;
 	TArray<class ADefrostPuzzleBlock*> PuzzleBlocks;
 	TArray<class ADefrostPuzzlePiece*> PuzzlePieces;
 	class ADefrostPuzzlePiece* PuzzleGoalPiece;
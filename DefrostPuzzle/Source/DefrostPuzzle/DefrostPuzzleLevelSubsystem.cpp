@@ -0,0 +1,216 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "DefrostPuzzleLevelSubsystem.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/ScopeLock.h"
+
+bool FDefrostPuzzleLevel::CreateField(game::Field& Field) const
+{
+	return Cells.Unpack(Field);
+}
+
+UDefrostPuzzleLevelSubsystem::UDefrostPuzzleLevelSubsystem()
+	: QueueDepth(4)
+	, WorkerCount(2)
+	, MinMoves(4)
+	, MaxMoves(20)
+	, LevelWidth(20)
+	, LevelHeight(20)
+	, LevelSeed(0)
+	, NextIndex(0)
+	, Generation(0)
+{
+}
+
+void UDefrostPuzzleLevelSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	LevelSeed = FPlatformTime::Cycles64();
+
+	// ゲーム中ずっと動かし、レベルを読み込み直しても用意した盤面を使い続ける
+	if (FPlatformProcess::SupportsMultithreading())
+	{
+		for (int32 WorkerIndex = 0; WorkerIndex < WorkerCount; ++WorkerIndex)
+		{
+			Workers.Add(MakeUnique<FWorker>(this, WorkerIndex));
+		}
+	}
+}
+
+void UDefrostPuzzleLevelSubsystem::Deinitialize()
+{
+	// ワーカーの破棄でスレッドの終了を待つ
+	Workers.Reset();
+	LocalGenerator.Reset();
+
+	{
+		FScopeLock Lock(&Mutex);
+		ReadyLevels.clear();
+	}
+
+	Super::Deinitialize();
+}
+
+bool UDefrostPuzzleLevelSubsystem::PopLevel(const int32 Width, const int32 Height, FDefrostPuzzleLevel& OutLevel)
+{
+	bool bPopped = false;
+	{
+		FScopeLock Lock(&Mutex);
+		if (Width != LevelWidth || Height != LevelHeight)
+		{
+			LevelWidth = Width;
+			LevelHeight = Height;
+			++Generation;
+			ReadyLevels.clear();
+		}
+		else if (!ReadyLevels.empty())
+		{
+			OutLevel = MoveTemp(ReadyLevels.front());
+			ReadyLevels.pop_front();
+			bPopped = true;
+		}
+	}
+
+	// 空きができたので補充させる
+	for (auto& Worker : Workers)
+	{
+		Worker->Wake();
+	}
+	return bPopped;
+}
+
+bool UDefrostPuzzleLevelSubsystem::GenerateLevelStep(const int32 Width, const int32 Height, FDefrostPuzzleLevel& OutLevel)
+{
+	if (!LocalGenerator)
+	{
+		LocalGenerator = MakeUnique<FLocalGenerator>();
+	}
+
+	game::LevelGenerator::Parameter Param;
+	game::LevelGenerator::Result Result;
+	SetLevelParameter(Width, Height, Param);
+	{
+		FScopeLock Lock(&Mutex);
+		Param.field.seed = LevelSeed;
+		Param.field.index = NextIndex++;
+	}
+
+	if (!LocalGenerator->Generator.Generate(Param, LocalGenerator->Field, Result))
+	{
+		return false;
+	}
+	ToLevel(LocalGenerator->Field, Param, Result.moveCount, OutLevel);
+	return true;
+}
+
+int32 UDefrostPuzzleLevelSubsystem::GetReadyCount() const
+{
+	FScopeLock Lock(&Mutex);
+	return static_cast<int32>(ReadyLevels.size());
+}
+
+bool UDefrostPuzzleLevelSubsystem::ReserveLevel(game::LevelGenerator::Parameter& OutParam, uint32& OutGeneration)
+{
+	FScopeLock Lock(&Mutex);
+	if (static_cast<int32>(ReadyLevels.size()) >= QueueDepth)
+	{
+		return false;
+	}
+
+	SetLevelParameter(LevelWidth, LevelHeight, OutParam);
+	OutParam.field.seed = LevelSeed;
+	OutParam.field.index = NextIndex++;
+	OutGeneration = Generation;
+	return true;
+}
+
+void UDefrostPuzzleLevelSubsystem::PushLevel(FDefrostPuzzleLevel&& Level, const uint32 LevelGeneration)
+{
+	FScopeLock Lock(&Mutex);
+	if (LevelGeneration == Generation && static_cast<int32>(ReadyLevels.size()) < QueueDepth)
+	{
+		ReadyLevels.push_back(MoveTemp(Level));
+	}
+}
+
+void UDefrostPuzzleLevelSubsystem::SetLevelParameter(const int32 Width, const int32 Height, game::LevelGenerator::Parameter& OutParam) const
+{
+	OutParam.field.width = Width;
+	OutParam.field.height = Height;
+	OutParam.pieceNum = 4;
+	OutParam.minMoves = MinMoves;
+	OutParam.maxMoves = MaxMoves;
+}
+
+void UDefrostPuzzleLevelSubsystem::ToLevel(const game::Field& Field, const game::LevelGenerator::Parameter& Param, const int32 MoveCount, FDefrostPuzzleLevel& OutLevel)
+{
+	OutLevel.Width = Field.GetWidth();
+	OutLevel.Height = Field.GetHeight();
+	OutLevel.MoveCount = MoveCount;
+	OutLevel.Seed = Param.field.seed;
+	OutLevel.Index = Param.field.index;
+	OutLevel.Cells.Pack(Field, game::PackedField::Encoding::Cell4);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+UDefrostPuzzleLevelSubsystem::FWorker::FWorker(UDefrostPuzzleLevelSubsystem* InOwner, const int32 WorkerIndex)
+	: Owner(InOwner)
+	, WakeEvent(FPlatformProcess::GetSynchEventFromPool(false))
+	, Thread(nullptr)
+	, bStopping(false)
+	, Generator()
+	, Field()
+{
+	Thread = FRunnableThread::Create(this, *FString::Printf(TEXT("DefrostPuzzleLevelWorker%d"), WorkerIndex), 0, TPri_BelowNormal);
+}
+
+UDefrostPuzzleLevelSubsystem::FWorker::~FWorker()
+{
+	if (Thread)
+	{
+		// Stop を呼んでから終了を待つ
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+	FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+}
+
+uint32 UDefrostPuzzleLevelSubsystem::FWorker::Run()
+{
+	game::LevelGenerator::Parameter Param;
+	game::LevelGenerator::Result Result;
+	uint32 LevelGeneration = 0;
+
+	while (!bStopping)
+	{
+		// キューが埋まっている間は、取り出されて起こされるまで待つ
+		if (!Owner->ReserveLevel(Param, LevelGeneration))
+		{
+			WakeEvent->Wait(100);
+			continue;
+		}
+
+		// 一回の Generate は候補を一つ判定するだけなので、止める指示にすぐ応じられる
+		if (Generator.Generate(Param, Field, Result))
+		{
+			FDefrostPuzzleLevel Level;
+			ToLevel(Field, Param, Result.moveCount, Level);
+			Owner->PushLevel(MoveTemp(Level), LevelGeneration);
+		}
+	}
+	return 0;
+}
+
+void UDefrostPuzzleLevelSubsystem::FWorker::Stop()
+{
+	bStopping = true;
+	WakeEvent->Trigger();
+}
+
+void UDefrostPuzzleLevelSubsystem::FWorker::Wake()
+{
+	WakeEvent->Trigger();
+}
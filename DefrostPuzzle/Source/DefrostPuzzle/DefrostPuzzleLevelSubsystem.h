@@ -0,0 +1,118 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <deque>
+#include "Game/Field.h"
+#include "Game/LevelGenerator.h"
+#include "Game/PackedField.h"
+#include "HAL/Event.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/ThreadSafeBool.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "DefrostPuzzleLevelSubsystem.generated.h"
+
+/** A generated level whose optimal move count has been verified */
+struct FDefrostPuzzleLevel
+{
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 MoveCount = 0;
+	uint64 Seed = 0;
+	uint64 Index = 0;
+	game::PackedField Cells;	// キューに溜めておく間は 4bit に詰めて持つ
+
+	// 盤面を Field に作る
+	bool CreateField(game::Field& Field) const;
+};
+
+/** Generates and verifies levels on worker threads, keeping a queue of ready levels across level loads */
+UCLASS(Config=Game)
+class UDefrostPuzzleLevelSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UDefrostPuzzleLevelSubsystem();
+
+	/** Number of verified levels kept ready */
+	UPROPERTY(Config)
+	int32 QueueDepth;
+
+	/** Number of worker threads generating levels */
+	UPROPERTY(Config)
+	int32 WorkerCount;
+
+	/** Shortest optimal move count accepted */
+	UPROPERTY(Config)
+	int32 MinMoves;
+
+	/** Longest optimal move count accepted */
+	UPROPERTY(Config)
+	int32 MaxMoves;
+
+	// Begin USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	// End USubsystem interface
+
+	// 用意できている盤面を一つ取り出す（無ければ false）
+	// 大きさが前回と違う場合は、用意していた盤面を捨ててその大きさで作り直す
+	bool PopLevel(const int32 Width, const int32 Height, FDefrostPuzzleLevel& OutLevel);
+	// ワーカーが裏で盤面を作っているか（マルチスレッドに対応していない環境では作らない）
+	bool HasWorkers() const { return Workers.Num() > 0; }
+	// ワーカーがいない場合に、呼び出したスレッドで候補を一つだけ作って確かめる（採用されなければ false）
+	// 一回で判定するのは一つだけなので、毎フレーム呼んでもそのフレームで止まるのは一つの探索の間だけ
+	bool GenerateLevelStep(const int32 Width, const int32 Height, FDefrostPuzzleLevel& OutLevel);
+	// 用意できている盤面の数
+	int32 GetReadyCount() const;
+
+private:
+	class FWorker : public FRunnable
+	{
+	public:
+		FWorker(UDefrostPuzzleLevelSubsystem* Owner, const int32 WorkerIndex);
+		virtual ~FWorker();
+
+		// Begin FRunnable interface
+		virtual uint32 Run() override;
+		virtual void Stop() override;
+		// End FRunnable interface
+
+		void Wake();
+
+	private:
+		UDefrostPuzzleLevelSubsystem* Owner;
+		FEvent* WakeEvent;
+		FRunnableThread* Thread;
+		FThreadSafeBool bStopping;
+		game::LevelGenerator Generator;
+		game::Field Field;
+	};
+
+	// GenerateLevelStep で使う（ワーカーがいない場合だけ作る）
+	struct FLocalGenerator
+	{
+		game::LevelGenerator Generator;
+		game::Field Field;
+	};
+
+	// キューに空きがあれば、次に作る盤面の番号を予約する
+	bool ReserveLevel(game::LevelGenerator::Parameter& OutParam, uint32& OutGeneration);
+	void PushLevel(FDefrostPuzzleLevel&& Level, const uint32 LevelGeneration);
+	void SetLevelParameter(const int32 Width, const int32 Height, game::LevelGenerator::Parameter& OutParam) const;
+	static void ToLevel(const game::Field& Field, const game::LevelGenerator::Parameter& Param, const int32 MoveCount, FDefrostPuzzleLevel& OutLevel);
+
+private:
+	mutable FCriticalSection Mutex;
+	std::deque<FDefrostPuzzleLevel> ReadyLevels;
+	TArray<TUniquePtr<FWorker>> Workers;
+	TUniquePtr<FLocalGenerator> LocalGenerator;
+	int32 LevelWidth;
+	int32 LevelHeight;
+	uint64 LevelSeed;
+	uint64 NextIndex;
+	uint32 Generation;	// 大きさを変えるたびに進め、古い大きさで作られた盤面を捨てる
+};
@@ -103,8 +103,9 @@ void ADefrostPuzzlePawn::ResetAllPieces()
 {
 	PuzzleBlockGrid->ResetPieces();
 	PuzzleBlockGrid->UpdatePuzzlePiecesMesh();
-	PuzzleBlockGrid->ResetScore();
 	PieceCommands.Empty();
+	// 戻した手は初期位置からの手ではなくなるので、やり直せないようにする
+	UndoRedoCommands.Empty();
 }
 
 void ADefrostPuzzlePawn::UndoPiece()
@@ -114,9 +115,8 @@ void ADefrostPuzzlePawn::UndoPiece()
 		auto command = PieceCommands.Pop();
 		UndoRedoCommands.Push(command);
 
-		PuzzleBlockGrid->SetPiecePosition(command.PieceIndex, command.BeforePosition);
+		PuzzleBlockGrid->UndoMove(command.BeforePieces, PieceCommands.Num());
 		PuzzleBlockGrid->UpdatePuzzlePiecesMesh();
-		PuzzleBlockGrid->SetScore(command.BeforeScore);
 	}
 }
 
@@ -127,9 +127,8 @@ void ADefrostPuzzlePawn::RedoPiece()
 		auto command = UndoRedoCommands.Pop();
 		PieceCommands.Push(command);
 
-		PuzzleBlockGrid->SetPiecePosition(command.PieceIndex, command.AfterPosition);
+		PuzzleBlockGrid->RedoMove(command.PieceIndex, command.FromCell, command.AfterPieces, PieceCommands.Num());
 		PuzzleBlockGrid->UpdatePuzzlePiecesMesh();
-		PuzzleBlockGrid->SetScore(command.AfterScore);
 	}
 }
 
@@ -197,9 +196,10 @@ void ADefrostPuzzlePawn::TraceForBlock(const FVector& Start, const FVector& End,
 		if (HitResult.Actor->GetClass() == ADefrostPuzzleBlock::StaticClass())
 		{
 			ADefrostPuzzleBlock* HitBlock = Cast<ADefrostPuzzleBlock>(HitResult.Actor.Get());
-			auto hitPosition = PuzzleBlockGrid->GetPuzzleBlockPosition(HitBlock);
-			const int hitX = std::get<0>(hitPosition), hitY = std::get<1>(hitPosition);
-			auto piece = PuzzleBlockGrid->GetPieces()[CurrentPieceIndex];
+			const int32 GridWidth = PuzzleBlockGrid->Width;
+			const int hitX = game::GetCellColumn(HitBlock->Cell, GridWidth), hitY = game::GetCellRow(HitBlock->Cell, GridWidth);
+			const game::CellIndex piece = PuzzleBlockGrid->GetPieceCell(CurrentPieceIndex);
+			const int pieceX = game::GetCellColumn(piece, GridWidth), pieceY = game::GetCellRow(piece, GridWidth);
 
 			int onPieceIndex = PuzzleBlockGrid->IsOnPiece(HitBlock);
 			if (onPieceIndex >= 0)
@@ -209,13 +209,13 @@ void ADefrostPuzzlePawn::TraceForBlock(const FVector& Start, const FVector& End,
 			}
 			else
 			{
-				if (hitX == piece.x)
+				if (hitX == pieceX)
 				{
-					CurrentPieceDirection = (hitY < piece.y) ? EPuzzleDirection::Up : EPuzzleDirection::Down;
+					CurrentPieceDirection = (hitY < pieceY) ? EPuzzleDirection::Up : EPuzzleDirection::Down;
 				}
-				else if (hitY == piece.y)
+				else if (hitY == pieceY)
 				{
-					CurrentPieceDirection = (hitX < piece.x) ? EPuzzleDirection::Left : EPuzzleDirection::Right;
+					CurrentPieceDirection = (hitX < pieceX) ? EPuzzleDirection::Left : EPuzzleDirection::Right;
 				}
 
 				SelectionMode = PuzzleBlockSelectMode::Direction;
@@ -230,7 +230,7 @@ void ADefrostPuzzlePawn::TraceForBlock(const FVector& Start, const FVector& End,
 #endif
 }
 
-void ADefrostPuzzlePawn::OnBlockMeshClicked(ADefrostPuzzleBlock* ClickedBlock, const std::pair<int32, int32>& position, const int index)
+void ADefrostPuzzlePawn::OnBlockMeshClicked(ADefrostPuzzleBlock* ClickedBlock, const game::CellIndex Cell)
 {
 	if (!PuzzleBlockGrid->CanPlayerControllable()) return;
 
@@ -247,14 +247,12 @@ void ADefrostPuzzlePawn::OnBlockMeshClicked(ADefrostPuzzleBlock* ClickedBlock, c
 		PieceCommand command;
 		command.PieceIndex = CurrentPieceIndex;
 		command.PieceDirection = CurrentPieceDirection;
-		command.BeforePosition = PuzzleBlockGrid->GetPuzzlePiecePositionByIndex(CurrentPieceIndex);
-		command.BeforeScore = PuzzleBlockGrid->GetScore();
+		command.BeforePieces = PuzzleBlockGrid->GetPieces();
+		command.FromCell = PuzzleBlockGrid->GetPieceCell(CurrentPieceIndex);
 		PuzzleBlockGrid->MovePiece(CurrentPieceIndex, CurrentPieceDirection);
-		command.AfterScore = PuzzleBlockGrid->GetScore();
-		command.AfterPosition = PuzzleBlockGrid->GetPuzzlePiecePositionByIndex(CurrentPieceIndex);
+		command.AfterPieces = PuzzleBlockGrid->GetPieces();
 		PieceCommands.Push(command);
 		//PuzzleBlockGrid->UpdatePuzzlePiecesMesh();
-		PuzzleBlockGrid->AddScore();
 		UndoRedoCommands.Empty();
 		break;
 	}
@@ -264,9 +262,9 @@ void ADefrostPuzzlePawn::OnBlockMeshClicked(ADefrostPuzzleBlock* ClickedBlock, c
 
 }
 
-void ADefrostPuzzlePawn::OnPieceMeshClicked(ADefrostPuzzlePiece* ClickedPiece, const std::pair<int32, int32>& position, const int index)
+void ADefrostPuzzlePawn::OnPieceMeshClicked(ADefrostPuzzlePiece* ClickedPiece, const game::CellIndex Cell, const int PieceIndex)
 {
 	if (!PuzzleBlockGrid->CanPlayerControllable()) return;
 
-	CurrentPieceIndex = index;
+	CurrentPieceIndex = PieceIndex;
 }
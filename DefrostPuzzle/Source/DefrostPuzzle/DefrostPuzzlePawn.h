@@ -39,8 +39,8 @@ protected:
 	void TriggerClick();
 	void TraceForBlock(const FVector& Start, const FVector& End, bool bDrawDebugHelpers);
 
-	void OnBlockMeshClicked(class ADefrostPuzzleBlock* ClickedBlock, const std::pair<int32, int32>& position, const int index) override;
-	void OnPieceMeshClicked(class ADefrostPuzzlePiece* ClickedPiece, const std::pair<int32, int32>& position, const int index) override;
+	void OnBlockMeshClicked(class ADefrostPuzzleBlock* ClickedBlock, const game::CellIndex Cell) override;
+	void OnPieceMeshClicked(class ADefrostPuzzlePiece* ClickedPiece, const game::CellIndex Cell, const int PieceIndex) override;
 
 	UPROPERTY(EditInstanceOnly, BlueprintReadWrite)
 	class ADefrostPuzzleBlock* CurrentBlockFocus;
@@ -56,11 +56,10 @@ private:
 	struct PieceCommand
 	{
 		int32 PieceIndex;
-		int32 BeforeScore;
-		int32 AfterScore;
 		EPuzzleDirection PieceDirection;
-		std::pair<int32, int32> BeforePosition;
-		std::pair<int32, int32> AfterPosition;
+		game::CellIndex FromCell;	// 動かす前のピースのセル（やり直すときに溶かし始める位置）
+		game::PieceSet BeforePieces;
+		game::PieceSet AfterPieces;
 	};
 
 private:
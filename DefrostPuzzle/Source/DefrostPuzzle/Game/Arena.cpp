@@ -0,0 +1,145 @@
+#include "Arena.h"
+
+#include <cstdlib>
+
+namespace game
+{
+
+Arena::Arena(const size_t blockSize, const size_t maxRetainedSize)
+    : m_BlockSize(blockSize)
+    , m_MaxRetainedSize(maxRetainedSize)
+    , m_Head(nullptr)
+    , m_Current(nullptr)
+    , m_Offset(0)
+    , m_Used(0)
+    , m_Peak(0)
+    , m_BlockAllocationCount(0)
+    , m_Failed(false)
+{
+
+}
+
+Arena::~Arena()
+{
+    FreeBlocks(m_Head);
+}
+
+void* Arena::Allocate(const size_t size, const size_t alignment)
+{
+    for (;;)
+    {
+        if (m_Current)
+        {
+            const uintptr_t base = reinterpret_cast<uintptr_t>(BlockData(m_Current));
+            const uintptr_t aligned = (base + m_Offset + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+            const size_t end = static_cast<size_t>(aligned - base) + size;
+
+            if (end <= m_Current->size)
+            {
+                m_Used += end - m_Offset;
+                m_Offset = end;
+                if (m_Used > m_Peak)
+                {
+                    m_Peak = m_Used;
+                }
+                return reinterpret_cast<void*>(aligned);
+            }
+
+            // 残りは捨てて次のブロックへ
+            m_Used += m_Current->size - m_Offset;
+            m_Offset = m_Current->size;
+
+            if (m_Current->next)
+            {
+                m_Current = m_Current->next;
+                m_Offset = 0;
+                continue;
+            }
+        }
+
+        const size_t required = size + alignment;
+        Block* block = AllocateBlock(required > m_BlockSize ? required : m_BlockSize);
+        if (block == nullptr)
+        {
+            m_Failed = true;
+            return nullptr;
+        }
+        if (m_Current)
+        {
+            m_Current->next = block;
+        }
+        else
+        {
+            m_Head = block;
+        }
+        m_Current = block;
+        m_Offset = 0;
+    }
+}
+
+void Arena::Reset()
+{
+    const size_t total = GetReservedBytes();
+    if (total > m_MaxRetainedSize)
+    {
+        // 持ち続けるには大きすぎるので手放す（次の Allocate で通常の大きさから確保し直す）
+        FreeBlocks(m_Head);
+        m_Head = nullptr;
+    }
+    else if (m_Head && m_Head->next)
+    {
+        // 複数のブロックにまたがった場合は、合計サイズの一ブロックにまとめ直す
+        // （確保できなければ今のブロックをそのまま使い続ける）
+        Block* merged = AllocateBlock(total);
+        if (merged)
+        {
+            FreeBlocks(m_Head);
+            m_Head = merged;
+        }
+    }
+
+    m_Current = m_Head;
+    m_Offset = 0;
+    m_Used = 0;
+    m_Failed = false;
+}
+
+size_t Arena::GetReservedBytes() const
+{
+    size_t total = 0;
+    for (Block* block = m_Head; block; block = block->next)
+    {
+        total += block->size;
+    }
+    return total;
+}
+
+Arena::Block* Arena::AllocateBlock(const size_t size)
+{
+    auto* block = static_cast<Block*>(std::malloc(sizeof(Block) + size));
+    if (block == nullptr)
+    {
+        return nullptr;
+    }
+    block->next = nullptr;
+    block->size = size;
+    ++m_BlockAllocationCount;
+    return block;
+}
+
+void Arena::FreeBlocks(Block* block)
+{
+    while (block)
+    {
+        Block* next = block->next;
+        std::free(block);
+        block = next;
+    }
+}
+
+uint8_t* Arena::BlockData(Block* block)
+{
+    return reinterpret_cast<uint8_t*>(block + 1);
+}
+
+} // namespace game
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+
+namespace game
+{
+
+// 単調増加のみを行うメモリ領域
+// 個別の解放はできず、Reset でまとめて巻き戻す
+// 前回までに使ったブロックは Reset 後も保持するので、同じ規模の処理を繰り返す限りヒープ確保は発生しない
+// （ただし maxRetainedSize を超えた分は Reset で手放し、一度の大きな処理で確保したままにならないようにする）
+// ヒープから確保できなかったときは Allocate が nullptr を返し、次の Reset まで HasFailed が true になる
+class Arena
+{
+public:
+    explicit Arena(size_t blockSize = 64 * 1024, size_t maxRetainedSize = 32 * 1024 * 1024);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* Allocate(size_t size, size_t alignment);
+    void Reset();
+
+    template <class T>
+    T* AllocateArray(const size_t count)
+    {
+        return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    // 前回の Reset からの使用量（単調増加なので、そのまま最大使用量になる）
+    size_t GetUsedBytes() const { return m_Used; }
+    // これまでの最大使用量
+    size_t GetPeakBytes() const { return m_Peak; }
+    // 確保済みの総容量
+    size_t GetReservedBytes() const;
+    // ヒープから確保したブロックの累計数
+    size_t GetBlockAllocationCount() const { return m_BlockAllocationCount; }
+    // 前回の Reset から確保に失敗したことがあるか
+    bool HasFailed() const { return m_Failed; }
+
+private:
+    struct Block
+    {
+        Block* next;
+        size_t size;
+    };
+
+    Block* AllocateBlock(size_t size);
+    void FreeBlocks(Block* block);
+    static uint8_t* BlockData(Block* block);
+
+private:
+    size_t m_BlockSize;
+    size_t m_MaxRetainedSize;   // Reset 後も持ち続ける最大の容量
+    Block* m_Head;
+    Block* m_Current;       // 現在割り当て中のブロック
+    size_t m_Offset;        // m_Current 内の使用済みバイト数
+    size_t m_Used;
+    size_t m_Peak;
+    size_t m_BlockAllocationCount;
+    bool m_Failed;
+};
+
+// Arena から領域を取る可変長配列
+// 要素は memcpy で移動するので、トリビアルにコピーできる型に限る
+template <class T>
+class ArenaVector
+{
+public:
+    explicit ArenaVector(Arena& arena)
+        : m_Arena(&arena)
+        , m_Data(nullptr)
+        , m_Size(0)
+        , m_Capacity(0)
+    {}
+
+    // 確保できなければ false を返し、中身はそのまま残す
+    bool Reserve(const size_t capacity)
+    {
+        if (capacity <= m_Capacity)
+        {
+            return true;
+        }
+        T* data = m_Arena->AllocateArray<T>(capacity);
+        if (data == nullptr)
+        {
+            return false;
+        }
+        if (m_Size > 0)
+        {
+            std::memcpy(data, m_Data, sizeof(T) * m_Size);
+        }
+        m_Data = data;
+        m_Capacity = capacity;
+        return true;
+    }
+
+    bool PushBack(const T& value)
+    {
+        if (m_Size == m_Capacity && !Reserve(m_Capacity < 16 ? 16 : m_Capacity * 2))
+        {
+            return false;
+        }
+        m_Data[m_Size++] = value;
+        return true;
+    }
+
+    T& operator[](const size_t index) { return m_Data[index]; }
+    const T& operator[](const size_t index) const { return m_Data[index]; }
+    T* Data() { return m_Data; }
+    const T* Data() const { return m_Data; }
+    size_t Size() const { return m_Size; }
+
+private:
+    Arena* m_Arena;
+    T* m_Data;
+    size_t m_Size;
+    size_t m_Capacity;
+};
+
+} // namespace game
@@ -1,155 +1,322 @@
 #include "Field.h"
 
 #include "Utility.h"
-#include <random>
+#include <algorithm>
 #include <iterator>
+#include <cstring>
 #include <numeric>
-#include <istream>
-#include <sstream> 
+#include <tuple>
+#include <utility>
 
 namespace game
 {
 
+namespace
+{
+
+// 10 進の幅や高さを読む（5 桁まで、読めなければ nullptr）
+const char* ParseFieldSize(const char* p, const char* const end, int& value)
+{
+    const char* const begin = p;
+    value = 0;
+    while (p < end && p - begin < 5 && *p >= '0' && *p <= '9')
+    {
+        value = value * 10 + (*p++ - '0');
+    }
+    return p != begin ? p : nullptr;
+}
+
+} // namespace
+
 Field::Field()
-    : m_Field(nullptr)
+    : m_Cells()
     , m_Width(0)
     , m_Height(0)
     , m_Goal(0, 0)
     , m_Pieces()
+    , m_Hash(0)
+    , m_HashValid(false)
+    , m_Random()
 {
 
 }
 
+Field::Field(Field&& other) noexcept
+    : m_Cells(std::move(other.m_Cells))
+    , m_Width(other.m_Width)
+    , m_Height(other.m_Height)
+    , m_Goal(other.m_Goal)
+    , m_Pieces(std::move(other.m_Pieces))
+    , m_Hash(other.m_Hash)
+    , m_HashValid(other.m_HashValid)
+    , m_Random(other.m_Random)
+{
+    other.m_Width = other.m_Height = 0;
+    other.m_HashValid = false;
+}
+
 Field::~Field() 
 {
     Destroy();
 }
 
+Field& Field::operator=(Field&& other) noexcept
+{
+    if (this != &other)
+    {
+        m_Cells = std::move(other.m_Cells);
+        m_Width = other.m_Width;
+        m_Height = other.m_Height;
+        m_Goal = other.m_Goal;
+        m_Pieces = std::move(other.m_Pieces);
+        m_Hash = other.m_Hash;
+        m_HashValid = other.m_HashValid;
+        m_Random = other.m_Random;
+        other.m_Width = other.m_Height = 0;
+        other.m_HashValid = false;
+    }
+    return *this;
+}
+
 bool Field::Create(const CreateParameter& param)
 {
+    // 既定値のままだと、どの呼び出し元も同じ盤面の並びを作ってしまう
+    _ASSERT(param.seed != CreateParameter::UnsetSeed);
     CreateField(param.width, param.height);
+    m_Random = Random(param.seed, param.index);
 
-    // tB[h
+    // フィールドを初期化
     {
         FillField(CellType::Frozen);
 
         for (int x = 0; x < m_Width; ++x)
         {
-            m_Field[0][x] = CellType::Block;
-            m_Field[param.height - 1][x] = CellType::Block;
+            At(x, 0) = CellType::Block;
+            At(x, param.height - 1) = CellType::Block;
         }
 
         for (int y = 0; y < m_Height; ++y)
         {
-            m_Field[y][0] = CellType::Block;
-            m_Field[y][param.width - 1] = CellType::Block;
+            At(0, y) = CellType::Block;
+            At(param.width - 1, y) = CellType::Block;
         }
 
-        // eӂɓubNu
+        // 各辺に二つずつブロックを置く
         {
             constexpr int offset = 2;
-            std::mt19937 mt{ std::random_device{}() };
 
             auto getr2 = [&](const int base)
             {
-                std::uniform_int_distribution<int> distFirst(offset, base / 2);
-                const int v1 = distFirst(mt);
-                std::uniform_int_distribution<int> distSecond(v1 + 2, base - offset);
-                const int v2 = distSecond(mt);
+                const int v1 = m_Random.Range(offset, base / 2);
+                const int v2 = m_Random.Range(v1 + 2, base - offset);
                 return std::tuple<int, int>(v1, v2);
             };
 
             const auto w1 = getr2(m_Width), w2 = getr2(m_Width);
             const auto h1 = getr2(m_Height), h2 = getr2(m_Height);
-            m_Field[1][std::get<0>(w1)] = CellType::Block;
-            m_Field[1][std::get<1>(w1)] = CellType::Block;
-            m_Field[m_Height - 2][std::get<0>(w2)] = CellType::Block;
-            m_Field[m_Height - 2][std::get<1>(w2)] = CellType::Block;
-            m_Field[std::get<0>(h1)][1] = CellType::Block;
-            m_Field[std::get<1>(h1)][1] = CellType::Block;
-            m_Field[std::get<0>(h2)][m_Width - 2] = CellType::Block;
-            m_Field[std::get<1>(h2)][m_Width - 2] = CellType::Block;
+            At(std::get<0>(w1), 1) = CellType::Block;
+            At(std::get<1>(w1), 1) = CellType::Block;
+            At(std::get<0>(w2), m_Height - 2) = CellType::Block;
+            At(std::get<1>(w2), m_Height - 2) = CellType::Block;
+            At(1, std::get<0>(h1)) = CellType::Block;
+            At(1, std::get<1>(h1)) = CellType::Block;
+            At(m_Width - 2, std::get<0>(h2)) = CellType::Block;
+            At(m_Width - 2, std::get<1>(h2)) = CellType::Block;
         }
     }
 
-    // 쐬
-    // iƂ̓tB[hɑ݂O̃ubNɈ͂܂ꂽ_
-    // @Ⴆ Corner::LeftUp ̃^Cv̏  ubNƂ
-    // @
-    // @
-    // @
-    // @Ƃ悤Ȍ`ƂȂAS[͂ɔzuj
-    CreateIsland(param.level);
-
-    return true;
+    // 小島を作成
+    // （小島とはフィールド上に存在する三つのブロックに囲まれた一点
+    // 　例えば Corner::LeftUp のタイプの小島は ■ をブロックとすると
+    // 　■■□
+    // 　■□□
+    // 　□□□
+    // 　というような形となり、ゴールはここに配置される）
+    return CreateIsland(param.level);
 }
 
 bool Field::CreateFromString(const char* serialized)
 {
-    auto raw = std::string(serialized);
-
-    std::stringstream ss{ raw };
-    std::string buf;
+    return CreateFromText(serialized, std::strlen(serialized)) == ParseError::None;
+}
 
-    std::vector<std::string> v;
-    while (std::getline(ss, buf, ','))
+Field::ParseError Field::CreateFromText(const char* text, const size_t length)
+{
+    const char* const end = text + length;
+    const char* p = text;
+    int width = 0, height = 0;
+    if ((p = ParseFieldSize(p, end, width)) == nullptr || p == end || *p++ != ','
+        || (p = ParseFieldSize(p, end, height)) == nullptr || p == end || *p++ != ',')
+    {
+        return ParseError::Format;
+    }
+    // セル番号は CellIndex に収める
+    if (width == 0 || height == 0 || static_cast<int64_t>(width) * height >= InvalidCellIndex)
     {
-        v.push_back(buf);
+        return ParseError::Size;
     }
 
-    if (v.size() != 3)
+    // セルの種類かピース（'a' が 0 番）と、続く数（36 進一桁）の組が並ぶ
+    CreateField(width, height);
+    CellType* cells = m_Cells->data();
+    const int cellNum = width * height;
+    int filled = 0;
+    m_Goal = Position(0, 0);
+    m_Pieces.clear();
+    while (p < end)
     {
-        return false;
+        if (end - p < 2)
+        {
+            return ParseError::Format;
+        }
+        const char symbol = p[0];
+        const int run = Utility::DecodeRunCount(p[1]) + 1;
+        p += 2;
+        if (run <= 0)
+        {
+            return ParseError::Format;
+        }
+        if (run > cellNum - filled)
+        {
+            return ParseError::Length;
+        }
+
+        if (symbol >= 'a' && symbol <= 'z')
+        {
+            const size_t piece = static_cast<size_t>(symbol - 'a');
+            if (run != 1 || (piece < m_Pieces.size() && m_Pieces[piece].x >= 0))
+            {
+                return ParseError::Piece;
+            }
+            if (piece >= m_Pieces.size())
+            {
+                m_Pieces.resize(piece + 1, Position(-1, -1));
+            }
+            m_Pieces[piece] = Position(filled % width, filled / width);
+            cells[filled++] = CellType::Piece;
+            continue;
+        }
+
+        if (symbol < '0' || symbol > '0' + static_cast<int>(CellType::Goal))
+        {
+            return ParseError::Cell;
+        }
+        const CellType cell = static_cast<CellType>(symbol - '0');
+        if (cell == CellType::Goal)
+        {
+            const int goal = filled + run - 1;
+            m_Goal = Position(goal % width, goal / width);
+        }
+        std::fill(cells + filled, cells + filled + run, cell);
+        filled += run;
     }
 
-    CreateField(atoi(v[0].c_str()), atoi(v[1].c_str()));
+    if (filled != cellNum)
+    {
+        return ParseError::Length;
+    }
+    for (const auto& piece : m_Pieces)
+    {
+        if (piece.x < 0)
+        {
+            return ParseError::Piece;
+        }
+    }
+    return ParseError::None;
+}
 
-    std::string decoded;
-    game::Utility::DecodeRunLength(v[2], decoded);
+size_t Field::CreateFromBinary(const uint8_t* data, const size_t size)
+{
+    const uint8_t* const end = data + size;
+    uint64_t version = 0, width = 0, height = 0, pieceNum = 0;
+    const uint8_t* p = data;
+    if ((p = Utility::ReadVarint(p, end, version)) == nullptr || version != BinaryVersion
+        || (p = Utility::ReadVarint(p, end, width)) == nullptr
+        || (p = Utility::ReadVarint(p, end, height)) == nullptr
+        || (p = Utility::ReadVarint(p, end, pieceNum)) == nullptr)
+    {
+        return 0;
+    }
 
-    if (decoded.length() != (m_Width * m_Height))
+    // セル番号は CellIndex に収める
+    const uint64_t cellCount = width * height;
+    if (width == 0 || height == 0 || width > InvalidCellIndex || height > InvalidCellIndex
+        || cellCount >= InvalidCellIndex || pieceNum > cellCount)
     {
-        return false;
+        return 0;
     }
 
-    game::Field::Position pieces[32];
-    int pieceCount = 0;
+    // セルは種類ごとの数を数えながら直接書き込む
+    static_assert(sizeof(CellType) == 1, "cells are decoded as bytes");
+    CreateField(static_cast<int>(width), static_cast<int>(height));
+    CellType* cells = m_Cells->data();
+    size_t counts[Utility::ByteRunValueNum] = {};
+    if ((p = Utility::DecodeByteRuns(p, end, reinterpret_cast<uint8_t*>(cells), static_cast<size_t>(cellCount), counts)) == nullptr)
+    {
+        return 0;
+    }
+    for (int value = static_cast<int>(CellType::Goal) + 1; value < Utility::ByteRunValueNum; ++value)
+    {
+        if (counts[value] != 0)
+        {
+            return 0;
+        }
+    }
 
-    const char* p = decoded.c_str();
-    for (int y = 0; y < m_Height; ++y)
+    // Goal のセルはちょうど一つで、ピースの位置はどれも Piece のセル、Piece のセルにはちょうど一つずつピースが乗っていなければならない
+    // （読んだピースのセルは一旦 Frozen にしておき、同じセルを二度指したものを弾く）
+    if (counts[static_cast<int>(CellType::Goal)] != 1 || counts[static_cast<int>(CellType::Piece)] != pieceNum)
     {
-        for (int x = 0; x < m_Width; ++x)
+        return 0;
+    }
+    const int goal = static_cast<int>(std::find(cells, cells + cellCount, CellType::Goal) - cells);
+    m_Goal = Position(goal % m_Width, goal / m_Width);
+    m_Pieces.clear();
+    for (uint64_t piece = 0; piece < pieceNum; ++piece)
+    {
+        uint64_t cell = 0;
+        if ((p = Utility::ReadVarint(p, end, cell)) == nullptr || cell >= cellCount || cells[cell] != CellType::Piece)
         {
-            int index = m_Width * y + x;
+            return 0;
+        }
+        cells[cell] = CellType::Frozen;
+        m_Pieces.push_back(Position(static_cast<int>(cell) % m_Width, static_cast<int>(cell) / m_Width));
+    }
+    for (const auto& piece : m_Pieces)
+    {
+        At(piece.x, piece.y) = CellType::Piece;
+    }
 
-            if (p[index] >= 'a' && p[index] <= 'z')
-            {
-                int pieceIndex = p[index] - 'a';
-                pieces[pieceIndex].x = x;
-                pieces[pieceIndex].y = y;
-                ++pieceCount;
+    return static_cast<size_t>(p - data);
+}
 
-                m_Field[y][x] = CellType::Piece;
-            }
-            else
-            {
-                CellType cell = static_cast<CellType>(p[index] - '0');
+bool Field::CreateFromCells(const int width, const int height, const CellType* cells, const std::vector<Position>& pieces)
+{
+    if (width <= 0 || height <= 0)
+    {
+        return false;
+    }
 
-                if (cell == CellType::Goal)
-                {
-                    m_Goal = Position(x, y);
-                }
+    CreateField(width, height);
+    std::copy(cells, cells + width * height, m_Cells->begin());
 
-                m_Field[y][x] = cell;
-            }
-        }
+    m_Goal = Position(0, 0);
+    const auto goal = std::find(m_Cells->begin(), m_Cells->end(), CellType::Goal);
+    if (goal != m_Cells->end())
+    {
+        const int index = static_cast<int>(goal - m_Cells->begin());
+        m_Goal = Position(index % m_Width, index / m_Width);
     }
 
     m_Pieces.clear();
-    m_Pieces.resize(pieceCount);
-    for (int count = 0; count < pieceCount; ++count)
+    for (const auto& piece : pieces)
     {
-        m_Pieces[count] = pieces[count];
+        if (piece.x < 0 || piece.y < 0 || piece.x >= m_Width || piece.y >= m_Height)
+        {
+            return false;
+        }
+        At(piece.x, piece.y) = CellType::Piece;
+        m_Pieces.push_back(piece);
     }
 
     return true;
@@ -160,73 +327,100 @@ void Field::Destroy()
     DestroyField();
 }
 
-void Field::Dump(std::function<void(const CellType**, int, int)> dumper)
-{
-    dumper(const_cast<const CellType**>(m_Field), m_Width, m_Height);
-}
-
-void Field::PutPieces(std::vector<Position>& pieces, const int putNum)
+bool Field::PutPieces(std::vector<Position>& pieces, const int putNum)
 {
     constexpr int offset = 2;
-    std::mt19937 mt{ std::random_device{}() };
 
-    std::uniform_int_distribution<int> distX(offset, m_Width - offset);
-    std::uniform_int_distribution<int> distY(offset, m_Height - offset);
+    pieces.clear();
+    DetachCells();
 
-    auto getPos = [&]() { return std::tuple<int, int>(distX(mt), distY(mt)); };
-    auto checkPos = [&](const int px, const int py)
+    // ゴールから四方向にブロックまでたどり、ゴールが一直線に見えるセルに印を付ける
+    // （ゴールが見えるセルは必ずゴールと同じ行か列にあるので、ゴールから伸ばすだけでよい）
+    std::vector<uint8_t> seesGoal(m_Width * m_Height, 0);
     {
-        if (m_Field[py][px] != CellType::Frozen) { return false; }
-
-        for (int x = px; x < m_Width; ++x)
-        {
-            if (m_Field[py][x] == CellType::Block) { break; }
-            if (m_Field[py][x] == CellType::Goal) { return false; }
-        }
-        for (int y = py; y < m_Height; ++y)
+        const int steps[][2] = { { 0, -1 }, { -1, 0 }, { 1, 0 }, { 0, 1 } };
+        for (const auto& step : steps)
         {
-            if (m_Field[y][px] == CellType::Block) { break; }
-            if (m_Field[y][px] == CellType::Goal) { return false; }
-        }
-        for (int x = px; x >= 0; --x)
-        {
-            if (m_Field[py][x] == CellType::Block) { break; }
-            if (m_Field[py][x] == CellType::Goal) { return false; }
+            int x = m_Goal.x + step[0], y = m_Goal.y + step[1];
+            while (x >= 0 && y >= 0 && x < m_Width && y < m_Height && At(x, y) != CellType::Block)
+            {
+                seesGoal[y * m_Width + x] = 1;
+                x += step[0];
+                y += step[1];
+            }
         }
-        for (int y = py; y >= 0; --y)
+    }
+
+    // 置けるセルの一覧を作り、そこから重複なしで選ぶ
+    std::vector<Position> candidates;
+    for (int y = offset; y <= m_Height - offset; ++y)
+    {
+        for (int x = offset; x <= m_Width - offset; ++x)
         {
-            if (m_Field[y][px] == CellType::Block) { break; }
-            if (m_Field[y][px] == CellType::Goal) { return false; }
+            if (At(x, y) == CellType::Frozen && !seesGoal[y * m_Width + x])
+            {
+                candidates.push_back(Position(x, y));
+            }
         }
-        return true;
-    };
-
-    pieces.clear();
+    }
 
-    auto count = putNum;
-    while (count > 0)
+    if (putNum < 0 || static_cast<int>(candidates.size()) < putNum)
     {
-        auto pos = getPos();
+        return false;
+    }
 
-        const int px = std::get<0>(pos), py = std::get<1>(pos);
-        if (checkPos(px, py))
-        {
-            m_Field[py][px] = CellType::Piece;
+    for (int count = 0; count < putNum; ++count)
+    {
+        const int picked = count + static_cast<int>(m_Random.Below(static_cast<uint32_t>(candidates.size() - count)));
+        std::swap(candidates[count], candidates[picked]);
 
-            pieces.push_back(Field::Position(px, py));
-            --count;
-        }
+        const auto& pos = candidates[count];
+        ChangeCell(pos.x, pos.y, CellType::Piece);
+        pieces.push_back(pos);
     }
 
+    ToggleMainPieceHash();
     m_Pieces.clear();
     copy(pieces.begin(), pieces.end(), back_inserter(m_Pieces));
+    ToggleMainPieceHash();
+    return true;
+}
+
+void Field::SetPieces(const std::vector<Position>& pieces)
+{
+    DetachCells();
+
+    for (auto& piece : m_Pieces)
+    {
+        if (At(piece.x, piece.y) == CellType::Piece)
+        {
+            ChangeCell(piece.x, piece.y, CellType::Frozen);
+        }
+    }
+
+    ToggleMainPieceHash();
+    m_Pieces = pieces;
+    ToggleMainPieceHash();
+
+    for (auto& piece : m_Pieces)
+    {
+        ChangeCell(piece.x, piece.y, CellType::Piece);
+    }
 }
 
 Field::CellType Field::GetCell(const int x, const int y) const
 {
     _ASSERT(x < m_Width&& y < m_Height);
 
-    return m_Field[y][x];
+    return At(x, y);
+}
+
+void Field::SetCell(const int x, const int y, const CellType cellType)
+{
+    _ASSERT(x < m_Width&& y < m_Height);
+
+    DetachCells();
+    ChangeCell(x, y, cellType);
 }
 
 Field::Position Field::GetGoalPosition() const
@@ -234,6 +428,27 @@ Field::Position Field::GetGoalPosition() const
     return m_Goal;
 }
 
+const std::vector<Field::Position>& Field::GetPieces() const
+{
+    return m_Pieces;
+}
+
+uint64_t Field::ComputeHash() const
+{
+    uint64_t hash = 0;
+    const ConstRow cells = GetCells();
+    for (int index = 0; index < cells.GetSize(); ++index)
+    {
+        hash ^= Zobrist::Cell(static_cast<CellIndex>(index), static_cast<int>(cells[index]));
+    }
+    // ピースのセルは Piece になっているので、サブピースと区別するためにメインピースの位置だけ加える
+    if (!m_Pieces.empty())
+    {
+        hash ^= Zobrist::Piece(0, MakeCellIndex(m_Pieces[0].x, m_Pieces[0].y, m_Width));
+    }
+    return hash;
+}
+
 void Field::Serialize(std::string& dist) const
 {
     dist.clear();
@@ -242,18 +457,13 @@ void Field::Serialize(std::string& dist) const
     dist.append(std::to_string(m_Height));
     dist.append(",");
 
-    std::string cells;
-    for (int y = 0; y < m_Height; ++y)
+    // セルの種類はすべて一桁
+    const ConstRow source = GetCells();
+    std::string cells(source.GetSize(), '0');
+    for (int index = 0; index < source.GetSize(); ++index)
     {
-        for (int x = 0; x < m_Width; ++x)
-        {
-            cells.append(std::to_string(
-                static_cast<int>(m_Field[y][x]))
-            );
-        }
+        cells[index] = static_cast<char>('0' + static_cast<int>(source[index]));
     }
-
-    
     for (int count = 0, size = m_Pieces.size(); count < size; ++count)
     {
         auto& piece = m_Pieces[count];
@@ -261,76 +471,129 @@ void Field::Serialize(std::string& dist) const
         cells[index] = 'a' + count;
     }
 
-    std::string encoded;
-    dist.append(game::Utility::EncodeRunLength(cells, encoded));
+    // 符号化した結果は dist の末尾に直接書く
+    const size_t offset = dist.size();
+    dist.resize(offset + Utility::GetEncodedCapacity(cells.size()));
+    dist.resize(offset + Utility::EncodeRunLength(cells.data(), cells.size(), &dist[offset]));
 }
 
-void Field::CreateField(const int width, const int height)
+void Field::SerializeBinary(std::vector<uint8_t>& dist) const
 {
-    DestroyField();
+    Utility::WriteVarint(BinaryVersion, dist);
+    Utility::WriteVarint(static_cast<uint64_t>(m_Width), dist);
+    Utility::WriteVarint(static_cast<uint64_t>(m_Height), dist);
+    Utility::WriteVarint(m_Pieces.size(), dist);
+
+    const ConstRow cells = GetCells();
+    Utility::EncodeByteRuns(reinterpret_cast<const uint8_t*>(cells.begin()), cells.GetSize(), dist);
+
+    for (const auto& piece : m_Pieces)
+    {
+        Utility::WriteVarint(static_cast<uint64_t>(MakeCellIndex(piece.x, piece.y, m_Width)), dist);
+    }
+}
 
+// 盤面全体を一度に確保する（共有していない Field を作り直す場合は、足りるなら確保し直さない）
+void Field::CreateField(const int width, const int height)
+{
     m_Width = width;
     m_Height = height;
-
-    m_Field = new CellType * [m_Height];
-    for (int y = 0; y < m_Height; ++y)
+    m_HashValid = false;
+    if (m_Cells && m_Cells.use_count() == 1)
     {
-        m_Field[y] = new CellType[m_Width];
+        m_Cells->resize(width * height);
+    }
+    else
+    {
+        m_Cells = std::make_shared<std::vector<CellType>>(width * height);
     }
 }
 
 void Field::DestroyField()
 {
-    if (m_Field)
+    m_Cells.reset();
+    m_Width = m_Height = 0;
+    m_HashValid = false;
+}
+
+// 他の Field と共有しているセルを書き換える前に、自分の分を複製する
+void Field::ChangeCell(const int x, const int y, const CellType cellType)
+{
+    CellType& cell = At(x, y);
+    if (m_HashValid)
     {
-        for (int y = 0; y < m_Height; ++y)
-        {
-            delete[] m_Field[y];
-        }
-        delete[] m_Field;
+        m_Hash = Zobrist::ChangeCell(m_Hash, MakeCellIndex(x, y, m_Width), static_cast<int>(cell), static_cast<int>(cellType));
+    }
+    cell = cellType;
+}
 
-        m_Field = nullptr;
+void Field::ToggleMainPieceHash()
+{
+    if (m_HashValid && !m_Pieces.empty())
+    {
+        m_Hash ^= Zobrist::Piece(0, MakeCellIndex(m_Pieces[0].x, m_Pieces[0].y, m_Width));
     }
-    m_Width = m_Height = 0;
 }
 
-void Field::CreateIsland(const int islandNum)
+void Field::DetachCells()
 {
-    constexpr int offset = 2;
-    std::mt19937 mt{ std::random_device{}() };
+    if (m_Cells && m_Cells.use_count() > 1)
+    {
+        m_Cells = std::make_shared<std::vector<CellType>>(*m_Cells);
+    }
+}
+
+bool Field::CreateIsland(const int islandNum)
+{
+    // 小島の中心から見て [-area, area) の範囲がすべて Frozen なら置ける
+    constexpr int area = 3;
 
-    std::uniform_int_distribution<int> distX(offset, m_Width - offset);
-    std::uniform_int_distribution<int> distY(offset, m_Height - offset);
+    // Frozen 以外のセル数の累積和（sums[(y + 1) * stride + (x + 1)] が (0, 0) から (x, y) までの合計）
+    // 範囲内に Frozen 以外があるかを O(1) で調べられる
+    const int stride = m_Width + 1;
+    std::vector<int> sums(stride * (m_Height + 1), 0);
+    for (int y = 0; y < m_Height; ++y)
+    {
+        for (int x = 0; x < m_Width; ++x)
+        {
+            sums[(y + 1) * stride + (x + 1)] = (At(x, y) != CellType::Frozen ? 1 : 0)
+                + sums[y * stride + (x + 1)] + sums[(y + 1) * stride + x] - sums[y * stride + x];
+        }
+    }
 
-    // w肳ꂽCfbNẌ͈͂̃ubN`FbN
-    auto checkArea = [this](int cx, int cy)
+    auto isFree = [&](const int cx, const int cy)
     {
-        constexpr int area = 3;
+        const int x0 = cx - area, y0 = cy - area, x1 = cx + area, y1 = cy + area;
+        return sums[y1 * stride + x1] - sums[y0 * stride + x1] - sums[y1 * stride + x0] + sums[y0 * stride + x0] == 0;
+    };
 
-        for (int y = cy - area; y < cy + area; ++y)
+    // ブロックを置き、累積和のうち影響する範囲（右下側）だけを更新する
+    auto putBlock = [&](const int x, const int y)
+    {
+        At(x, y) = CellType::Block;
+        for (int sy = y + 1; sy <= m_Height; ++sy)
         {
-            if (y < 0 || y > m_Height - 1)
+            for (int sx = x + 1; sx <= m_Width; ++sx)
             {
-                return false;
+                ++sums[sy * stride + sx];
             }
+        }
+    };
 
-            for (int x = cx - area; x < cx + area; ++x)
+    // 置ける中心の一覧（範囲が盤面からはみ出さない位置のみ）
+    std::vector<Position> centers;
+    for (int cy = area; cy <= m_Height - area; ++cy)
+    {
+        for (int cx = area; cx <= m_Width - area; ++cx)
+        {
+            if (isFree(cx, cy))
             {
-                if (x < 0 || x > m_Width - 1)
-                {
-                    return false;
-                }
-
-                if (m_Field[y][x] != CellType::Frozen)
-                {
-                    return false;
-                }
+                centers.push_back(Position(cx, cy));
             }
         }
-        return true;
-    };
+    }
 
-    // \\
+    // 小島を表す構造体
     struct Island : public Position
     {
         enum class Corner : uint8_t
@@ -349,67 +612,66 @@ void Field::CreateIsland(const int islandNum)
     };
     std::vector<Island> islands;
 
-    int level = islandNum;
-    while (level > 0)
+    // 置くたびに置けなくなった中心を取り除くので、一覧が尽きれば必ず終わる
+    while (static_cast<int>(islands.size()) < islandNum && !centers.empty())
     {
-        const int tempX = distX(mt), tempY = distY(mt);
+        const auto center = centers[m_Random.Below(static_cast<uint32_t>(centers.size()))];
+        const int tempX = center.x, tempY = center.y;
 
-        if (checkArea(tempX, tempY))
+        const auto corner = static_cast<Island::Corner>(m_Random.Range(0, 3));
+        switch (corner)
         {
-            --level;
+        case Island::Corner::LeftUp:
+            putBlock(tempX - 1, tempY);
+            putBlock(tempX - 1, tempY - 1);
+            putBlock(tempX, tempY - 1);
+            break;
+        case Island::Corner::RightUp:
+            putBlock(tempX, tempY - 1);
+            putBlock(tempX + 1, tempY - 1);
+            putBlock(tempX + 1, tempY);
+            break;
+        case Island::Corner::LeftBottom:
+            putBlock(tempX - 1, tempY);
+            putBlock(tempX - 1, tempY + 1);
+            putBlock(tempX, tempY + 1);
+            break;
+        case Island::Corner::RightBottom:
+            putBlock(tempX + 1, tempY);
+            putBlock(tempX + 1, tempY + 1);
+            putBlock(tempX, tempY + 1);
+            break;
+        }
 
-            std::uniform_int_distribution<int> distDir(0, 3);
-            const auto corner = static_cast<Island::Corner>(distDir(mt));
-            switch (corner)
-            {
-            case Island::Corner::LeftUp:
-                m_Field[tempY][tempX - 1] = CellType::Block;
-                m_Field[tempY - 1][tempX - 1] = CellType::Block;
-                m_Field[tempY - 1][tempX] = CellType::Block;
-                break;
-            case Island::Corner::RightUp:
-                m_Field[tempY - 1][tempX] = CellType::Block;
-                m_Field[tempY - 1][tempX + 1] = CellType::Block;
-                m_Field[tempY][tempX + 1] = CellType::Block;
-                break;
-            case Island::Corner::LeftBottom:
-                m_Field[tempY][tempX - 1] = CellType::Block;
-                m_Field[tempY + 1][tempX - 1] = CellType::Block;
-                m_Field[tempY + 1][tempX] = CellType::Block;
-                break;
-            case Island::Corner::RightBottom:
-                m_Field[tempY][tempX + 1] = CellType::Block;
-                m_Field[tempY + 1][tempX + 1] = CellType::Block;
-                m_Field[tempY + 1][tempX] = CellType::Block;
-                break;
-            }
+        const Island island(tempX, tempY, corner);
+        islands.push_back(island);
 
-            const Island island(tempX, tempY, corner);
-            islands.push_back(island);
-        }
+        centers.erase(std::remove_if(centers.begin(), centers.end(),
+            [&](const Position& position) { return !isFree(position.x, position.y); }), centers.end());
     }
 
-    // X^[gS[
+    if (islands.empty() || static_cast<int>(islands.size()) < islandNum)
+    {
+        return false;
+    }
+
+    // 小島からスタート＆ゴールを決定
     {
         std::vector<int> v(islandNum);
         std::iota(v.begin(), v.end(), 0);
-        std::shuffle(v.begin(), v.end(), mt);
+        m_Random.Shuffle(v.begin(), v.end());
 
         int goalIndex = v.front();
         m_Goal = static_cast<Position>(islands.at(goalIndex));
-        m_Field[m_Goal.y][m_Goal.x] = CellType::Goal;
+        At(m_Goal.x, m_Goal.y) = CellType::Goal;
     }
+
+    return true;
 }
 
 void Field::FillField(const CellType cellType)
 {
-    for (int y = 0; y < m_Height; ++y)
-    {
-        for (int x = 0; x < m_Width; ++x)
-        {
-            m_Field[y][x] = cellType;
-        }
-    }
+    std::fill(m_Cells->begin(), m_Cells->end(), cellType);
 }
 
 } // namespace game
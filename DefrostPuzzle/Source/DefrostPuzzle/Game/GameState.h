@@ -0,0 +1,56 @@
+#pragma once
+
+#include "CellIndex.h"
+#include "Zobrist.h"
+#include <cinttypes>
+#include <type_traits>
+
+namespace game
+{
+
+// 遊んでいる間に変わる部分（ピースのセル番号と手数）
+// 地形は Terrain に分けて共有するので、状態の複製や保存（アンドゥ、リプレイ）は数十バイトのコピーで済む
+// ピースの位置の Zobrist ハッシュも持ち、Terrain::Move で手を打つたびに O(1) で更新する
+struct GameState
+{
+    static constexpr int MaxPieces = 8;
+
+    CellIndex pieces[MaxPieces];    // 0 番がメインピース
+    uint16_t moveCount;
+    uint8_t pieceNum;
+    uint64_t hash;                  // ピースの位置だけから求める（手数は含めない）
+
+    // ハッシュをピースの位置から求め直す
+    void Rehash()
+    {
+        hash = 0;
+        for (int index = 0; index < pieceNum; ++index)
+        {
+            hash ^= Zobrist::Piece(index, pieces[index]);
+        }
+    }
+
+    // ピースが 4 つまでなら、位置だけを 64bit に詰めて保存できる（アンドゥの履歴など）
+    PieceSet PackPieces() const
+    {
+        PieceSet packed = 0;
+        for (int index = 0; index < pieceNum && index < PieceSetCapacity; ++index)
+        {
+            packed = SetPieceSetCell(packed, index, pieces[index]);
+        }
+        return packed;
+    }
+
+    void UnpackPieces(const PieceSet packed)
+    {
+        for (int index = 0; index < pieceNum && index < PieceSetCapacity; ++index)
+        {
+            pieces[index] = GetPieceSetCell(packed, index);
+        }
+        Rehash();
+    }
+};
+
+static_assert(std::is_trivially_copyable<GameState>::value, "GameState must be trivially copyable");
+
+} // namespace game
@@ -0,0 +1,132 @@
+#include "LevelGenerator.h"
+
+namespace game
+{
+
+LevelGenerator::LevelGenerator()
+    : m_Finder()
+    , m_Terrain()
+    , m_Occupancy()
+    , m_Distance()
+    , m_Queue()
+{
+
+}
+
+LevelGenerator::~LevelGenerator()
+{
+
+}
+
+bool LevelGenerator::Generate(const Parameter& param, Field& field, Result& result)
+{
+    result = Result();
+
+    if (!CreateCandidate(param, field))
+    {
+        return false;
+    }
+
+    result.reached = Stage::Screen;
+    if (!Screen(param, field))
+    {
+        return false;
+    }
+
+    result.reached = Stage::Solve;
+    if (!Solve(param, field, result))
+    {
+        return false;
+    }
+
+    result.reached = Stage::Accept;
+    return true;
+}
+
+bool LevelGenerator::CreateCandidate(const Parameter& param, Field& field)
+{
+    if (!field.Create(param.field))
+    {
+        return false;
+    }
+
+    std::vector<Field::Position> pieces;
+    return field.PutPieces(pieces, param.pieceNum);
+}
+
+bool LevelGenerator::Screen(const Parameter& param, const Field& field)
+{
+    // 他のピースを動かさずにメインピースだけで解ける手数は、最短手数の上限になる
+    // それが下限より少なければ、探索するまでもなく範囲外
+    if (param.minMoves <= 1)
+    {
+        return true;
+    }
+
+    GameState state;
+    m_Terrain.Reset(field);
+    if (!m_Terrain.CreateState(field.GetPieces(), state) || state.pieceNum == 0)
+    {
+        return true;
+    }
+    return SolveMainPieceOnly(m_Terrain, state, param.minMoves - 1) < 0;
+}
+
+bool LevelGenerator::Solve(const Parameter& param, const Field& field, Result& result)
+{
+    RouteFinder::Parameter findParam;
+    findParam.maxMoves = param.maxMoves;
+
+    RouteFinder::Result found;
+    if (!m_Finder.Find(field, findParam, found))
+    {
+        return false;
+    }
+
+    result.moveCount = found.moveCount;
+    return found.moveCount >= param.minMoves && found.moveCount <= param.maxMoves;
+}
+
+int LevelGenerator::SolveMainPieceOnly(const Terrain& terrain, const GameState& state, const int maxMoves)
+{
+    // サブピースは動かないので、メインピースを除いたピースの位置だけを occupancy に置いて滑らせる
+    m_Occupancy.Reset(terrain.GetWidth() * terrain.GetHeight());
+    m_Occupancy.Assign(state);
+    m_Occupancy.Clear(state.pieces[0]);
+
+    m_Distance.assign(terrain.GetWidth() * terrain.GetHeight(), -1);
+    m_Queue.clear();
+
+    GameState moved = state;
+    m_Distance[state.pieces[0]] = 0;
+    m_Queue.push_back(state.pieces[0]);
+
+    for (size_t head = 0; head < m_Queue.size(); ++head)
+    {
+        const CellIndex from = m_Queue[head];
+        const int distance = m_Distance[from];
+        if (distance >= maxMoves)
+        {
+            break;
+        }
+
+        moved.pieces[0] = from;
+        for (int direction = 0; direction < static_cast<int>(Field::Direction::Num); ++direction)
+        {
+            const CellIndex to = terrain.Slide(moved, m_Occupancy, 0, static_cast<Field::Direction>(direction));
+            if (m_Distance[to] >= 0)
+            {
+                continue;
+            }
+            if (terrain.IsClearCell(to))
+            {
+                return distance + 1;
+            }
+            m_Distance[to] = distance + 1;
+            m_Queue.push_back(to);
+        }
+    }
+    return -1;
+}
+
+} // namespace game
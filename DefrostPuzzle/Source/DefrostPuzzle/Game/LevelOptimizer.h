@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Field.h"
+#include "RouteFinder.h"
+#include "Random.h"
+#include <vector>
+
+namespace game
+{
+
+// 盤面内のブロックを動かして、最短手数が長く・最短解が少なくなるように地形を改良する（焼きなまし法）
+// ピースとゴールは動かさず、外周以外のブロック（小島と各辺のブロック）だけを一つずつ移動する
+// 変異のたびに盤面全体を解き直す（探索の手数と状態数には上限を設ける）
+// 前回の探索の層を使い回すことはしない（ブロックを一つ動かすと、ほとんどの変異で 0 から 2 手目の層の状態の手がもう変わる）
+// 代わりに、手数の上限とメインピースの手数の下限から、上限以内に解けない状態を RouteFinder が積まずに済ませる
+class LevelOptimizer
+{
+public:
+    struct Parameter
+    {
+        int iterations;             // 試す変異の数
+        int maxMoves;               // これより長い手数は探索しない
+        int moveMargin;             // 現在の手数からこれ以上長くなる盤面は探索しない（一変異で伸びる手数は限られる）
+        size_t maxStates;           // 一回の探索で調べる状態数の上限
+        int moveRange;              // ブロックを動かす最大距離（縦横それぞれ）
+        double startTemperature;    // 開始時の温度（手数単位）
+        double endTemperature;      // 終了時の温度（手数単位）
+        uint64_t seed;              // 同じ盤面と seed からは同じ結果になる
+
+        Parameter()
+            : iterations(2000)
+            , maxMoves(40)
+            , moveMargin(6)
+            , maxStates(1 << 20)
+            , moveRange(3)
+            , startTemperature(1.0)
+            , endTemperature(0.05)
+            , seed(0)
+        {
+
+        }
+    };
+
+    struct Result
+    {
+        int initialMoves;
+        int moveCount;          // 採用した盤面の最短手数
+        int solutionCount;      // 採用した盤面の最短解の数（RouteFinder::Result::solutionCount）
+        int mutations;          // 試した変異の数（変異ごとに一回解き直す）
+        int accepted;           // 受理した変異の数
+
+        Result()
+            : initialMoves(0)
+            , moveCount(0)
+            , solutionCount(0)
+            , mutations(0)
+            , accepted(0)
+        {}
+    };
+
+public:
+    LevelOptimizer();
+    ~LevelOptimizer();
+
+    // ピースを配置済みで解ける盤面を受け取り、見つかった最良の地形に書き換える
+    bool Optimize(const Parameter& param, Field& field, Result& result);
+
+private:
+    struct Score
+    {
+        bool solved;
+        int moveCount;
+        int solutionCount;
+
+        Score()
+            : solved(false)
+            , moveCount(0)
+            , solutionCount(0)
+        {}
+
+        // 手数を優先し、同じ手数なら最短解が少ないほうを良しとする
+        double Value() const
+        {
+            return moveCount - (solutionCount < 64 ? solutionCount : 64) / 128.0;
+        }
+    };
+
+    bool Solve(const Parameter& param, const Field& field, int maxMoves, Score& score);
+    bool IsMovable(int cell, int width, int height) const;
+
+private:
+    Random m_Random;
+    RouteFinder m_Finder;
+    std::vector<int> m_Rocks;
+    std::vector<Field::CellType> m_Best;
+};
+
+} // namespace game
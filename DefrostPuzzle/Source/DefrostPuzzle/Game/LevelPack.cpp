@@ -0,0 +1,214 @@
+#include "LevelPack.h"
+
+#include <cstring>
+
+namespace game
+{
+
+namespace
+{
+
+static_assert(sizeof(LevelPack::Header) == 32, "LevelPack::Header must be 32 bytes");
+static_assert(sizeof(LevelPack::Bucket) == 12, "LevelPack::Bucket must be 12 bytes");
+static_assert(sizeof(LevelPack::Entry) == 32, "LevelPack::Entry must be 32 bytes");
+
+const char LevelPackMagic[4] = { 'D', 'F', 'P', 'K' };
+
+size_t AlignLevelPack(const size_t offset)
+{
+    return (offset + 7) & ~static_cast<size_t>(7);
+}
+
+} // namespace
+
+LevelPack::LevelPack()
+    : m_Header(nullptr)
+    , m_Buckets(nullptr)
+    , m_Entries(nullptr)
+    , m_Data(nullptr)
+{
+
+}
+
+LevelPack::~LevelPack()
+{
+    Close();
+}
+
+bool LevelPack::Open(const void* data, const size_t size)
+{
+    Close();
+
+    // 確かめるのはヘッダと表の範囲だけ（盤面ごとの範囲は Load で確かめる）
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    if (bytes == nullptr || size < sizeof(Header) || reinterpret_cast<uintptr_t>(bytes) % alignof(Entry) != 0)
+    {
+        return false;
+    }
+
+    const Header* header = reinterpret_cast<const Header*>(bytes);
+    if (std::memcmp(header->magic, LevelPackMagic, sizeof(LevelPackMagic)) != 0 || header->version != Version)
+    {
+        return false;
+    }
+
+    const uint64_t bucketEnd = header->bucketOffset + static_cast<uint64_t>(header->bucketNum) * sizeof(Bucket);
+    const uint64_t entryEnd = header->entryOffset + static_cast<uint64_t>(header->levelNum) * sizeof(Entry);
+    const uint64_t dataEnd = header->dataOffset + static_cast<uint64_t>(header->dataSize);
+    if (bucketEnd > size || entryEnd > size || dataEnd > size
+        || header->bucketOffset % alignof(Bucket) != 0 || header->entryOffset % alignof(Entry) != 0)
+    {
+        return false;
+    }
+
+    m_Header = header;
+    m_Buckets = reinterpret_cast<const Bucket*>(bytes + header->bucketOffset);
+    m_Entries = reinterpret_cast<const Entry*>(bytes + header->entryOffset);
+    m_Data = bytes + header->dataOffset;
+    return true;
+}
+
+void LevelPack::Close()
+{
+    m_Header = nullptr;
+    m_Buckets = nullptr;
+    m_Entries = nullptr;
+    m_Data = nullptr;
+}
+
+int LevelPack::FindBucket(const int moveCount) const
+{
+    for (uint32_t bucket = 0; bucket < GetBucketNum(); ++bucket)
+    {
+        if (m_Buckets[bucket].minMoves <= moveCount && moveCount <= m_Buckets[bucket].maxMoves)
+        {
+            return static_cast<int>(bucket);
+        }
+    }
+    return -1;
+}
+
+bool LevelPack::PickLevel(const uint32_t bucket, Random& random, uint32_t& level) const
+{
+    if (bucket >= GetBucketNum() || m_Buckets[bucket].count == 0)
+    {
+        return false;
+    }
+    level = m_Buckets[bucket].first + random.Below(m_Buckets[bucket].count);
+    return level < GetLevelNum();
+}
+
+bool LevelPack::Load(const uint32_t level, Field& field) const
+{
+    if (level >= GetLevelNum())
+    {
+        return false;
+    }
+
+    const Entry& entry = m_Entries[level];
+    if (entry.dataOffset + static_cast<uint64_t>(entry.dataSize) > m_Header->dataSize)
+    {
+        return false;
+    }
+
+    return field.CreateFromBinary(m_Data + entry.dataOffset, entry.dataSize) == entry.dataSize;
+}
+
+LevelPackBuilder::LevelPackBuilder()
+    : m_Entries()
+    , m_Data()
+{
+
+}
+
+LevelPackBuilder::~LevelPackBuilder()
+{
+
+}
+
+bool LevelPackBuilder::Add(const Field& field, const int moveCount, const int solutionCount, const uint64_t seed, const uint64_t index)
+{
+    const int width = field.GetWidth(), height = field.GetHeight();
+    const auto& pieces = field.GetPieces();
+    if (width <= 0 || height <= 0 || width > LevelPack::MaxSize || height > LevelPack::MaxSize || pieces.size() > 0xFF)
+    {
+        return false;
+    }
+
+    LevelPack::Entry entry;
+    std::memset(&entry, 0, sizeof(entry));
+    entry.seed = seed;
+    entry.index = index;
+    entry.dataOffset = static_cast<uint32_t>(m_Data.size());
+    entry.moveCount = static_cast<uint16_t>(moveCount);
+    entry.solutionCount = static_cast<uint16_t>(solutionCount < 0xFFFF ? solutionCount : 0xFFFF);
+    entry.width = static_cast<uint8_t>(width);
+    entry.height = static_cast<uint8_t>(height);
+    entry.pieceNum = static_cast<uint8_t>(pieces.size());
+
+    field.SerializeBinary(m_Data);
+    entry.dataSize = static_cast<uint32_t>(m_Data.size() - entry.dataOffset);
+
+    m_Entries.push_back(entry);
+    return true;
+}
+
+void LevelPackBuilder::Build(const std::vector<int>& bucketMinMoves, std::vector<uint8_t>& output) const
+{
+    const uint32_t bucketNum = static_cast<uint32_t>(bucketMinMoves.size());
+    std::vector<LevelPack::Bucket> buckets(bucketNum);
+    std::vector<LevelPack::Entry> entries;
+    std::vector<uint8_t> data;
+    entries.reserve(m_Entries.size());
+
+    for (uint32_t bucket = 0; bucket < bucketNum; ++bucket)
+    {
+        const int minMoves = bucketMinMoves[bucket];
+        const int maxMoves = bucket + 1 < bucketNum ? bucketMinMoves[bucket + 1] - 1 : 0xFFFF;
+        buckets[bucket].minMoves = static_cast<uint16_t>(minMoves);
+        buckets[bucket].maxMoves = static_cast<uint16_t>(maxMoves);
+        buckets[bucket].first = static_cast<uint32_t>(entries.size());
+
+        for (const auto& source : m_Entries)
+        {
+            if (source.moveCount < minMoves || source.moveCount > maxMoves)
+            {
+                continue;
+            }
+
+            LevelPack::Entry entry = source;
+            entry.bucket = static_cast<uint8_t>(bucket);
+            entry.dataOffset = static_cast<uint32_t>(data.size());
+            data.insert(data.end(), m_Data.begin() + source.dataOffset, m_Data.begin() + source.dataOffset + source.dataSize);
+            entries.push_back(entry);
+        }
+        buckets[bucket].count = static_cast<uint32_t>(entries.size()) - buckets[bucket].first;
+    }
+
+    LevelPack::Header header;
+    std::memcpy(header.magic, LevelPackMagic, sizeof(LevelPackMagic));
+    header.version = LevelPack::Version;
+    header.levelNum = static_cast<uint32_t>(entries.size());
+    header.bucketNum = bucketNum;
+    header.bucketOffset = static_cast<uint32_t>(AlignLevelPack(sizeof(header)));
+    header.entryOffset = static_cast<uint32_t>(AlignLevelPack(header.bucketOffset + sizeof(LevelPack::Bucket) * buckets.size()));
+    header.dataOffset = static_cast<uint32_t>(AlignLevelPack(header.entryOffset + sizeof(LevelPack::Entry) * entries.size()));
+    header.dataSize = static_cast<uint32_t>(data.size());
+
+    output.assign(header.dataOffset + data.size(), 0);
+    std::memcpy(&output[0], &header, sizeof(header));
+    if (!buckets.empty())
+    {
+        std::memcpy(&output[header.bucketOffset], buckets.data(), sizeof(LevelPack::Bucket) * buckets.size());
+    }
+    if (!entries.empty())
+    {
+        std::memcpy(&output[header.entryOffset], entries.data(), sizeof(LevelPack::Entry) * entries.size());
+    }
+    if (!data.empty())
+    {
+        std::memcpy(&output[header.dataOffset], data.data(), data.size());
+    }
+}
+
+} // namespace game
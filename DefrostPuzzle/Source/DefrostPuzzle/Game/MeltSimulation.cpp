@@ -0,0 +1,120 @@
+#include "MeltSimulation.h"
+
+namespace game
+{
+
+MeltSimulation::MeltSimulation()
+    : m_Width(0)
+    , m_MeltedNum(0)
+    , m_Cells()
+    , m_Log()
+    , m_StepBegins()
+    , m_Changes()
+{
+
+}
+
+MeltSimulation::~MeltSimulation()
+{
+
+}
+
+void MeltSimulation::Reset(const Terrain& terrain)
+{
+    m_Width = terrain.GetWidth();
+    m_MeltedNum = 0;
+
+    const int cellCount = terrain.GetWidth() * terrain.GetHeight();
+    m_Cells.resize(cellCount);
+    for (int index = 0; index < cellCount; ++index)
+    {
+        m_Cells[index] = terrain.GetCell(static_cast<CellIndex>(index));
+    }
+    m_Log.clear();
+    m_StepBegins.clear();
+    m_Changes.clear();
+}
+
+const MeltSimulation::ChangeList& MeltSimulation::Step(const CellIndex from, const CellIndex to)
+{
+    m_Changes.clear();
+    m_StepBegins.push_back(static_cast<uint32_t>(m_Log.size()));
+    if (from == to)
+    {
+        return m_Changes;
+    }
+
+    // 盤面の外や、同じ行にも同じ列にもないセルの組は一直線に滑った手ではないので、何も溶かさない
+    // （手の数は合わせておき、Undo は何も戻さない）
+    const int cellCount = static_cast<int>(m_Cells.size());
+    const bool horizontal = GetCellRow(from, m_Width) == GetCellRow(to, m_Width);
+    const bool vertical = GetCellColumn(from, m_Width) == GetCellColumn(to, m_Width);
+    if (from >= cellCount || to >= cellCount || (!horizontal && !vertical))
+    {
+        _ASSERT(false);
+        return m_Changes;
+    }
+
+    // 同じ行なら横に、そうでなければ縦に滑っている
+    const int distance = static_cast<int>(to) - static_cast<int>(from);
+    const int step = horizontal ? (distance > 0 ? 1 : -1) : (distance > 0 ? m_Width : -m_Width);
+    for (int cell = from; cell != to; cell += step)
+    {
+        if (m_Cells[cell] == Field::CellType::Frozen)
+        {
+            m_Cells[cell] = Field::CellType::Melted;
+            m_Changes.push_back(Change(static_cast<CellIndex>(cell), Field::CellType::Frozen, Field::CellType::Melted));
+            ++m_MeltedNum;
+        }
+    }
+
+    // HardFrozen は通れないので、ひびが入るのは滑ってきたピースを止めたときだけ
+    const int hit = static_cast<int>(to) + step;
+    const bool inside = hit >= 0 && hit < static_cast<int>(m_Cells.size())
+        && (!horizontal || GetCellRow(static_cast<CellIndex>(hit), m_Width) == GetCellRow(to, m_Width));
+    if (inside && m_Cells[hit] == Field::CellType::HardFrozen)
+    {
+        m_Cells[hit] = Field::CellType::Cracked;
+        m_Changes.push_back(Change(static_cast<CellIndex>(hit), Field::CellType::HardFrozen, Field::CellType::Cracked));
+    }
+    m_Log.insert(m_Log.end(), m_Changes.begin(), m_Changes.end());
+    return m_Changes;
+}
+
+const MeltSimulation::ChangeList& MeltSimulation::Undo()
+{
+    m_Changes.clear();
+    if (!m_StepBegins.empty())
+    {
+        Revert(m_StepBegins.back());
+        m_StepBegins.pop_back();
+    }
+    return m_Changes;
+}
+
+const MeltSimulation::ChangeList& MeltSimulation::Rewind()
+{
+    m_Changes.clear();
+    Revert(0);
+    m_StepBegins.clear();
+    return m_Changes;
+}
+
+// m_Log の begin 以降を新しいものから順に戻し、戻したセルを m_Changes に加える
+void MeltSimulation::Revert(const size_t begin)
+{
+    while (m_Log.size() > begin)
+    {
+        const Change change = m_Log.back();
+        m_Log.pop_back();
+
+        if (change.after == Field::CellType::Melted)
+        {
+            --m_MeltedNum;
+        }
+        m_Cells[change.cell] = change.before;
+        m_Changes.push_back(Change(change.cell, change.after, change.before));
+    }
+}
+
+} // namespace game
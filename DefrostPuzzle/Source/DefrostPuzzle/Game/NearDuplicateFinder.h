@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Field.h"
+#include "Symmetry.h"
+#include <cinttypes>
+#include <vector>
+
+namespace game
+{
+
+// ブロックが一つ二つ違うだけの似た盤面をまとめる（MinHash と LSH）
+// 盤面を「どのセルに何があるか」の集合とみなし、集合の重なり（Jaccard 係数）を MinHash の署名で見積もる
+// 署名をいくつかの帯に分け、帯が丸ごと一致する盤面どうしだけを比べるので、全組み合わせを比べずにほぼ線形の時間で済む
+// 集合は Symmetry の正規形から作るので、回転・反転した盤面も同じものとして扱う
+class NearDuplicateFinder
+{
+public:
+    struct Parameter
+    {
+        int hashNum;            // 署名の長さ（bandNum で割り切れること）
+        int bandNum;            // 署名を分ける帯の数（一帯あたり hashNum / bandNum 個）
+        double threshold;       // 署名の一致率がこれ以上なら同じ組とする
+        uint64_t seed;          // ハッシュ関数を決める（同じ seed どうしの署名だけ比べられる）
+
+        Parameter()
+            : hashNum(64)
+            , bandNum(8)
+            , threshold(0.8)
+            , seed(0)
+        {
+
+        }
+    };
+
+    struct Result
+    {
+        int clusterNum;         // 組の数（似た盤面がないものも一つの組と数える）
+        int largestCluster;     // 最も大きい組の盤面数
+        size_t candidatePairs;  // 帯が一致して署名を比べた組の数
+        size_t mergedPairs;     // そのうち一致率が threshold 以上だった組の数
+
+        Result()
+            : clusterNum(0)
+            , largestCluster(0)
+            , candidatePairs(0)
+            , mergedPairs(0)
+        {}
+    };
+
+public:
+    NearDuplicateFinder();
+    ~NearDuplicateFinder();
+
+    void Reset(const Parameter& param);
+
+    // 盤面の署名を求めて追加する（Symmetry で扱えない大きさの盤面は追加しない）
+    bool Add(const Field& field);
+    bool Add(const Symmetry::Canonical& canonical);
+    size_t GetCount() const { return m_Count; }
+
+    // 追加した順の番号ごとに、組の代表（組の中で最も小さい番号）を clusters に入れる
+    void Cluster(std::vector<uint32_t>& clusters, Result& result);
+
+    // 署名の一致率（Jaccard 係数の推定値）
+    double GetSimilarity(size_t a, size_t b) const;
+
+private:
+    uint32_t Find(uint32_t index);
+    void Unite(uint32_t a, uint32_t b);
+
+private:
+    struct BandEntry
+    {
+        uint64_t key;
+        uint32_t index;
+
+        bool operator<(const BandEntry& other) const
+        {
+            return key != other.key ? key < other.key : index < other.index;
+        }
+    };
+
+    Parameter m_Param;
+    std::vector<uint64_t> m_Multipliers;    // ハッシュ関数ごとの係数（h(f) = (a * f + b) の上位 32bit）
+    std::vector<uint64_t> m_Offsets;
+    std::vector<uint32_t> m_Signatures;     // 盤面ごとに hashNum 個ずつ並べる
+    std::vector<uint64_t> m_Features;
+    std::vector<BandEntry> m_Band;
+    std::vector<uint32_t> m_Parents;
+    size_t m_Count;
+};
+
+} // namespace game
@@ -0,0 +1,33 @@
+#include "Occupancy.h"
+
+#include <algorithm>
+
+namespace game
+{
+
+Occupancy::Occupancy()
+    : m_Bits()
+{
+
+}
+
+Occupancy::~Occupancy()
+{
+
+}
+
+void Occupancy::Reset(const int cellCount)
+{
+    m_Bits.assign((cellCount + 63) / 64, 0);
+}
+
+void Occupancy::Assign(const GameState& state)
+{
+    std::fill(m_Bits.begin(), m_Bits.end(), 0);
+    for (int index = 0; index < state.pieceNum; ++index)
+    {
+        Set(state.pieces[index]);
+    }
+}
+
+} // namespace game
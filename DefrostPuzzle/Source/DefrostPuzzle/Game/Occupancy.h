@@ -0,0 +1,33 @@
+#pragma once
+
+#include "CellIndex.h"
+#include "GameState.h"
+#include <cinttypes>
+#include <vector>
+
+namespace game
+{
+
+// セルごとにピースがいるかどうかを 1bit で持つ
+// ピースが動くたびに更新しておけば、「ここにピースがいるか」はピースの数によらず一度のビット検査で済む
+class Occupancy
+{
+public:
+    Occupancy();
+    ~Occupancy();
+
+    // 盤面の大きさを決めて空にする
+    void Reset(int cellCount);
+    // 状態のピースの位置で作り直す（アンドゥ・リドゥなどで状態を差し替えたとき）
+    void Assign(const GameState& state);
+
+    bool Test(const CellIndex cell) const { return (m_Bits[cell >> 6] >> (cell & 63)) & 1; }
+    void Set(const CellIndex cell) { m_Bits[cell >> 6] |= 1ull << (cell & 63); }
+    void Clear(const CellIndex cell) { m_Bits[cell >> 6] &= ~(1ull << (cell & 63)); }
+    void Move(const CellIndex from, const CellIndex to) { Clear(from); Set(to); }
+
+private:
+    std::vector<uint64_t> m_Bits;
+};
+
+} // namespace game
@@ -0,0 +1,190 @@
+#include "PackedField.h"
+
+#include <cstring>
+
+namespace game
+{
+
+namespace
+{
+
+// 1 バイトを一セル一バイトに広げた並び（Cell4 は 2 セル、Terrain2 は 4 セル）
+struct PackedTable
+{
+    uint8_t cell4[256][2];
+    uint8_t terrain2[256][4];
+
+    PackedTable()
+    {
+        for (int packed = 0; packed < 256; ++packed)
+        {
+            for (int cell = 0; cell < 2; ++cell)
+            {
+                cell4[packed][cell] = static_cast<uint8_t>((packed >> (cell * 4)) & 0x0F);
+            }
+            for (int cell = 0; cell < 4; ++cell)
+            {
+                terrain2[packed][cell] = static_cast<uint8_t>((packed >> (cell * 2)) & 0x03);
+            }
+        }
+    }
+};
+
+const PackedTable PackedTables;
+
+uint8_t PackedTerrain(const Field::CellType cell)
+{
+    switch (cell)
+    {
+    case Field::CellType::Piece:
+        return static_cast<uint8_t>(Field::CellType::Frozen);
+    case Field::CellType::Goal:
+        return static_cast<uint8_t>(Field::CellType::Block);
+    default:
+        return static_cast<uint8_t>(cell);
+    }
+}
+
+} // namespace
+
+PackedField::PackedField()
+    : m_Data()
+    , m_Goal(0, 0)
+    , m_RowBytes(0)
+    , m_Width(0)
+    , m_Height(0)
+    , m_PieceNum(0)
+    , m_Encoding(Encoding::Cell4)
+    , m_HasGoal(false)
+{
+
+}
+
+PackedField::~PackedField()
+{
+
+}
+
+bool PackedField::Pack(const Field& field, const Encoding encoding)
+{
+    Clear();
+
+    const int width = field.GetWidth(), height = field.GetHeight();
+    const auto& pieces = field.GetPieces();
+    if (width <= 0 || height <= 0 || width > 0xFF || height > 0xFF || pieces.size() > 0xFF)
+    {
+        return false;
+    }
+
+    m_Encoding = encoding;
+    m_Width = static_cast<uint8_t>(width);
+    m_Height = static_cast<uint8_t>(height);
+    m_PieceNum = static_cast<uint8_t>(pieces.size());
+    m_RowBytes = static_cast<uint16_t>((width * GetBitsPerCell() + 7) / 8);
+    m_Goal = field.GetGoalPosition();
+    m_HasGoal = field.GetCell(m_Goal.x, m_Goal.y) == Field::CellType::Goal;
+
+    m_Data.assign(height * m_RowBytes + pieces.size() * 2, 0);
+    for (int y = 0; y < height; ++y)
+    {
+        const Field::ConstRow row = field.GetRow(y);
+        uint8_t* packed = &m_Data[y * m_RowBytes];
+        if (encoding == Encoding::Cell4)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                packed[x >> 1] |= static_cast<uint8_t>(static_cast<uint8_t>(row[x]) << ((x & 1) * 4));
+            }
+        }
+        else
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                packed[x >> 2] |= static_cast<uint8_t>(PackedTerrain(row[x]) << ((x & 3) * 2));
+            }
+        }
+    }
+
+    uint8_t* positions = &m_Data[height * m_RowBytes];
+    for (const auto& piece : pieces)
+    {
+        *positions++ = static_cast<uint8_t>(piece.x);
+        *positions++ = static_cast<uint8_t>(piece.y);
+    }
+    return true;
+}
+
+bool PackedField::Unpack(Field& field) const
+{
+    if (m_Data.empty())
+    {
+        return false;
+    }
+
+    std::vector<Field::CellType> cells(m_Width * m_Height);
+    for (int y = 0; y < m_Height; ++y)
+    {
+        DecodeRow(y, &cells[y * m_Width]);
+    }
+    if (m_Encoding == Encoding::Terrain2 && m_HasGoal)
+    {
+        cells[m_Goal.y * m_Width + m_Goal.x] = Field::CellType::Goal;
+    }
+
+    std::vector<Field::Position> pieces(m_PieceNum);
+    for (int piece = 0; piece < m_PieceNum; ++piece)
+    {
+        pieces[piece] = GetPiece(piece);
+    }
+    return field.CreateFromCells(m_Width, m_Height, cells.data(), pieces);
+}
+
+void PackedField::Clear()
+{
+    m_Data.clear();
+    m_Goal = Field::Position(0, 0);
+    m_RowBytes = 0;
+    m_Width = m_Height = m_PieceNum = 0;
+    m_HasGoal = false;
+}
+
+void PackedField::DecodeRow(const int y, Field::CellType* cells) const
+{
+    const uint8_t* packed = &m_Data[y * m_RowBytes];
+    uint8_t* decoded = reinterpret_cast<uint8_t*>(cells);
+
+    // 表を引いて 1 バイト分のセルをまとめて書き、最後の半端なバイトだけ一セルずつ書く
+    int x = 0;
+    if (m_Encoding == Encoding::Cell4)
+    {
+        for (; x + 2 <= m_Width; x += 2)
+        {
+            std::memcpy(decoded + x, PackedTables.cell4[packed[x >> 1]], 2);
+        }
+        for (; x < m_Width; ++x)
+        {
+            decoded[x] = PackedTables.cell4[packed[x >> 1]][x & 1];
+        }
+    }
+    else
+    {
+        for (; x + 4 <= m_Width; x += 4)
+        {
+            std::memcpy(decoded + x, PackedTables.terrain2[packed[x >> 2]], 4);
+        }
+        for (; x < m_Width; ++x)
+        {
+            decoded[x] = PackedTables.terrain2[packed[x >> 2]][x & 3];
+        }
+    }
+}
+
+Field::Position PackedField::GetPiece(const int index) const
+{
+    _ASSERT(index < m_PieceNum);
+
+    const uint8_t* position = &m_Data[m_Height * m_RowBytes + index * 2];
+    return Field::Position(position[0], position[1]);
+}
+
+} // namespace game
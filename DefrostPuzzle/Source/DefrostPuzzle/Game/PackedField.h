@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Field.h"
+#include <cinttypes>
+#include <vector>
+
+namespace game
+{
+
+// Field のセルを詰めて持つ（大量の盤面をメモリに置いておくため）
+// Cell4 はすべてのセルを 4bit で、Terrain2 は地形（Frozen / HardFrozen / Melted / Block）だけを 2bit で持つ
+// Terrain2 ではピースのセルを Frozen、ゴールのセルを Block として持ち、位置は別に持って Unpack で戻す
+// 行はバイト単位でそろえ、ピースの位置は盤面の後ろに (x, y) の 2 バイトずつ続ける
+class PackedField
+{
+public:
+    enum class Encoding : uint8_t
+    {
+        Cell4,
+        Terrain2,
+    };
+
+public:
+    PackedField();
+    ~PackedField();
+
+    bool Pack(const Field& field, Encoding encoding);
+    bool Unpack(Field& field) const;
+    void Clear();
+
+    // 詰めたままのセル（Terrain2 ではピースとゴールのセルも地形として返る）
+    Field::CellType GetCell(const int x, const int y) const
+    {
+        const int bits = GetBitsPerCell();
+        const int bit = x * bits;
+        const uint8_t packed = m_Data[y * m_RowBytes + (bit >> 3)];
+        return static_cast<Field::CellType>((packed >> (bit & 7)) & ((1 << bits) - 1));
+    }
+    // y 行目を一セル一バイトに戻して cells に書く（cells には幅の分の領域が必要）
+    void DecodeRow(int y, Field::CellType* cells) const;
+
+    Field::Position GetGoalPosition() const { return m_Goal; }
+    int GetPieceNum() const { return m_PieceNum; }
+    Field::Position GetPiece(int index) const;
+    int32_t GetWidth() const { return m_Width; }
+    int32_t GetHeight() const { return m_Height; }
+    Encoding GetEncoding() const { return m_Encoding; }
+    size_t GetDataSize() const { return m_Data.size(); }
+
+private:
+    int GetBitsPerCell() const { return m_Encoding == Encoding::Cell4 ? 4 : 2; }
+
+private:
+    std::vector<uint8_t> m_Data;
+    Field::Position m_Goal;
+    uint16_t m_RowBytes;
+    uint8_t m_Width;
+    uint8_t m_Height;
+    uint8_t m_PieceNum;
+    Encoding m_Encoding;
+    bool m_HasGoal;     // Terrain2 でゴールのセルを戻すかどうか
+};
+
+} // namespace game
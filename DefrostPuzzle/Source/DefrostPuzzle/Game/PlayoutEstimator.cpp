@@ -0,0 +1,250 @@
+#include "PlayoutEstimator.h"
+
+namespace game
+{
+
+namespace
+{
+
+constexpr int PlayoutDirectionNum = static_cast<int>(Field::Direction::Num);
+constexpr uint16_t PlayoutUnreachable = 0xFFFF;
+constexpr uint8_t PlayoutNoGreedy = static_cast<uint8_t>(PlayoutDirectionNum);
+
+// 動けない手を続けて引いたらそのプレイアウトは打ち切る（すべてのピースが動けない盤面で止まらないように）
+constexpr int PlayoutMaxStuck = 64;
+
+} // namespace
+
+PlayoutEstimator::PlayoutEstimator()
+    : m_Random()
+    , m_Terrain()
+    , m_Width(0)
+    , m_Stops(nullptr)
+    , m_Goals(nullptr)
+    , m_Columns()
+    , m_Distance()
+    , m_Greedy()
+{
+
+}
+
+PlayoutEstimator::~PlayoutEstimator()
+{
+
+}
+
+bool PlayoutEstimator::Estimate(const Field& field, const Parameter& param, Result& result)
+{
+    return Estimate(field, field.GetPieces(), param, result);
+}
+
+bool PlayoutEstimator::Estimate(const Field& field, const std::vector<Field::Position>& pieces, const Parameter& param, Result& result)
+{
+    result = Result();
+
+    GameState state;
+    m_Terrain.Reset(field);
+    if (!m_Terrain.CreateState(pieces, state))
+    {
+        return false;
+    }
+    return Estimate(m_Terrain, state, param, result);
+}
+
+bool PlayoutEstimator::Estimate(const Terrain& terrain, const GameState& state, const Parameter& param, Result& result)
+{
+    result = Result();
+
+    const int pieceNum = state.pieceNum;
+    if (pieceNum == 0 || param.playouts <= 0)
+    {
+        return false;
+    }
+
+    Build(terrain);
+    m_Random = Random(param.seed);
+
+    // 確率は 16bit の閾値にして、一手に一回だけ引く乱数から判定する
+    const double greedy = param.greedy < 0.0 ? 0.0 : (param.greedy > 1.0 ? 1.0 : param.greedy);
+    const uint32_t greedyThreshold = static_cast<uint32_t>(greedy * 65536.0);
+
+    uint64_t successMoves = 0;
+    for (int playout = 0; playout < param.playouts; ++playout)
+    {
+        uint16_t cells[GameState::MaxPieces];
+        for (int piece = 0; piece < pieceNum; ++piece)
+        {
+            cells[piece] = state.pieces[piece];
+        }
+
+        const int moves = Playout(cells, pieceNum, param, greedyThreshold);
+        if (moves > 0)
+        {
+            ++result.successes;
+            successMoves += moves;
+            result.simulatedMoves += moves;
+        }
+        else
+        {
+            result.simulatedMoves += -moves;
+        }
+    }
+
+    result.playouts = param.playouts;
+    result.successRate = static_cast<double>(result.successes) / param.playouts;
+    result.averageMoves = result.successes > 0 ? static_cast<double>(successMoves) / result.successes : 0.0;
+    return true;
+}
+
+void PlayoutEstimator::Build(const Terrain& terrain)
+{
+    const int width = terrain.GetWidth(), height = terrain.GetHeight();
+    const int cellCount = width * height;
+    m_Width = width;
+    m_Stops = terrain.GetStops();
+    m_Goals = terrain.GetGoals();
+
+    m_Columns.resize(cellCount);
+    for (int index = 0; index < cellCount; ++index)
+    {
+        m_Columns[index] = static_cast<uint8_t>(index % width);
+    }
+
+    // 他のピースを無視したメインピースの手数（止まった先の手数 + 1 の最小値を、変わらなくなるまで繰り返す）
+    m_Distance.assign(cellCount, PlayoutUnreachable);
+    for (int index = 0; index < cellCount; ++index)
+    {
+        if (m_Goals[index])
+        {
+            m_Distance[index] = 0;
+        }
+    }
+    for (bool changed = true; changed; )
+    {
+        changed = false;
+        for (int index = 0; index < cellCount; ++index)
+        {
+            if (!terrain.IsWalkable(static_cast<CellIndex>(index)))
+            {
+                continue;
+            }
+            for (int direction = 0; direction < PlayoutDirectionNum; ++direction)
+            {
+                const uint16_t next = m_Distance[m_Stops[index * 4 + direction]];
+                if (next != PlayoutUnreachable && next + 1 < m_Distance[index])
+                {
+                    m_Distance[index] = static_cast<uint16_t>(next + 1);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // 貪欲な手は地形だけで選んでおき、一手ごとにはその方向に一度滑らせるだけにする
+    // （乱数で引いた方向から順に調べ、最初に見つかった最も縮む方向を選ぶ）
+    m_Greedy.assign(cellCount * PlayoutDirectionNum, PlayoutNoGreedy);
+    for (int index = 0; index < cellCount; ++index)
+    {
+        for (int direction = 0; direction < PlayoutDirectionNum; ++direction)
+        {
+            int best = PlayoutUnreachable;
+            for (int candidate = 0; candidate < PlayoutDirectionNum; ++candidate)
+            {
+                const int rotated = (direction + candidate) & 3;
+                const int next = m_Stops[index * 4 + rotated];
+                if (next != index && m_Distance[next] < best)
+                {
+                    best = m_Distance[next];
+                    m_Greedy[index * 4 + direction] = static_cast<uint8_t>(rotated);
+                }
+            }
+        }
+    }
+}
+
+// 指定したピースを指定方向に滑らせた先のセル（地形の停止位置より手前にある他のピースの手前で止まる）
+int PlayoutEstimator::Slide(const uint16_t* cells, const int pieceNum, const int piece, const int direction) const
+{
+    switch (direction)
+    {
+    case 0: return Slide<0>(cells, pieceNum, piece);
+    case 1: return Slide<1>(cells, pieceNum, piece);
+    case 2: return Slide<2>(cells, pieceNum, piece);
+    default: return Slide<3>(cells, pieceNum, piece);
+    }
+}
+
+template <int D>
+int PlayoutEstimator::Slide(const uint16_t* cells, const int pieceNum, const int piece) const
+{
+    const int from = cells[piece];
+    int to = m_Stops[from * 4 + D];
+    if (to == from)
+    {
+        return from;
+    }
+
+    // 左右は同じ行の中でしか止まらないので範囲だけ、上下は同じ列かどうかも見る
+    constexpr bool vertical = D == static_cast<int>(Field::Direction::Up) || D == static_cast<int>(Field::Direction::Down);
+    constexpr bool forward = D == static_cast<int>(Field::Direction::Right) || D == static_cast<int>(Field::Direction::Down);
+    const int step = vertical ? (forward ? m_Width : -m_Width) : (forward ? 1 : -1);
+    const int column = m_Columns[from];
+
+    for (int other = 0; other < pieceNum; ++other)
+    {
+        const int p = cells[other];
+        if (other == piece || (vertical && m_Columns[p] != column))
+        {
+            continue;
+        }
+        if (forward ? (p > from && p <= to) : (p < from && p >= to))
+        {
+            to = p - step;
+        }
+    }
+    return to;
+}
+
+// クリアしたらその手数を、できなければ打った手数を負にして返す
+int PlayoutEstimator::Playout(uint16_t* cells, const int pieceNum, const Parameter& param, const uint32_t greedyThreshold)
+{
+    int moves = 0;
+    int stuck = 0;
+    while (moves < param.maxMoves && stuck < PlayoutMaxStuck)
+    {
+        // 乱数一つから、方向（下位 2bit）、貪欲に打つかどうか（続く 16bit）、ピース（上位 32bit）を取る
+        const uint64_t random = m_Random.Next();
+        int piece = 0, direction = static_cast<int>(random & 3), to = cells[0];
+
+        if (static_cast<uint32_t>((random >> 2) & 0xFFFF) < greedyThreshold)
+        {
+            // 地形で選んだ方向に滑らせる（他のピースに当たって動けなければ、ランダムな手にする）
+            const int greedy = m_Greedy[cells[0] * 4 + direction];
+            if (greedy != PlayoutNoGreedy)
+            {
+                to = Slide(cells, pieceNum, 0, greedy);
+            }
+        }
+        if (to == cells[0])
+        {
+            piece = static_cast<int>(((random >> 32) * static_cast<uint64_t>(pieceNum)) >> 32);
+            to = Slide(cells, pieceNum, piece, direction);
+            if (to == cells[piece])
+            {
+                ++stuck;
+                continue;
+            }
+        }
+
+        stuck = 0;
+        ++moves;
+        cells[piece] = static_cast<uint16_t>(to);
+        if (piece == 0 && m_Goals[to])
+        {
+            return moves;
+        }
+    }
+    return -moves;
+}
+
+} // namespace game
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Field.h"
+#include "GameState.h"
+#include "Random.h"
+#include "Terrain.h"
+#include <cinttypes>
+#include <vector>
+
+namespace game
+{
+
+// ランダムな手（一部はメインピースをゴールに近づける手）を打ち続けるプレイアウトを何度も行い、盤面の難しさを見積もる
+// 最短手数が同じでも、でたらめに動かしてすぐ解けてしまう盤面はやさしいとみなせる
+// 停止位置は地形だけで前計算しておき、一手ごとには他のピースとの衝突だけを調べる
+class PlayoutEstimator
+{
+public:
+    struct Parameter
+    {
+        int playouts;           // プレイアウトの回数
+        int maxMoves;           // 一回のプレイアウトで打つ手数の上限（K 手以内に解けた割合を求める）
+        double greedy;          // メインピースをゴールに近づける手を選ぶ確率（0 なら完全にランダム）
+        uint64_t seed;
+
+        Parameter()
+            : playouts(100000)
+            , maxMoves(50)
+            , greedy(0.0)
+            , seed(0)
+        {
+
+        }
+    };
+
+    struct Result
+    {
+        int playouts;
+        int successes;          // maxMoves 手以内にクリアしたプレイアウトの数
+        double successRate;
+        double averageMoves;    // クリアしたプレイアウトの、初めてクリアするまでの手数の平均
+        uint64_t simulatedMoves;    // 実際に滑らせた手の総数
+
+        Result()
+            : playouts(0)
+            , successes(0)
+            , successRate(0.0)
+            , averageMoves(0.0)
+            , simulatedMoves(0)
+        {}
+    };
+
+public:
+    PlayoutEstimator();
+    ~PlayoutEstimator();
+
+    bool Estimate(const Field& field, const Parameter& param, Result& result);
+    bool Estimate(const Field& field, const std::vector<Field::Position>& pieces, const Parameter& param, Result& result);
+    // 停止位置とクリア判定は Terrain が前計算したものを使う
+    bool Estimate(const Terrain& terrain, const GameState& state, const Parameter& param, Result& result);
+
+private:
+    void Build(const Terrain& terrain);
+    int Slide(const uint16_t* cells, int pieceNum, int piece, int direction) const;
+    template <int D>
+    int Slide(const uint16_t* cells, int pieceNum, int piece) const;
+    int Playout(uint16_t* cells, int pieceNum, const Parameter& param, uint32_t greedyThreshold);
+
+private:
+    Random m_Random;
+    Terrain m_Terrain;                  // Field から見積もるときに作る地形
+    int m_Width;
+    const uint16_t* m_Stops;            // 見積もっている Terrain の停止位置とクリア判定
+    const uint8_t* m_Goals;
+    std::vector<uint8_t> m_Columns;     // セルの x 座標（縦方向の衝突判定に使う）
+    std::vector<uint16_t> m_Distance;   // 他のピースを無視したときの、メインピースがクリアするまでの手数
+    std::vector<uint8_t> m_Greedy;      // (セル * 4 + 方向) から、その方向から順に調べたときに m_Distance が最も縮む方向（なければ 4）
+};
+
+} // namespace game
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cinttypes>
+
+namespace game
+{
+
+// カウンタベースの乱数（SplitMix64）
+// 状態は 64bit のカウンタだけなので作るのが軽く、(シード, 番号) から任意の系列を前の番号を待たずに作れる
+// 分布は標準ライブラリに任せず自前で持つ（処理系が変わっても同じシードから同じ盤面を作るため）
+class Random
+{
+public:
+    explicit Random(const uint64_t seed = 0)
+        : m_Counter(seed)
+    {}
+
+    // seed から index 番目の系列を作る
+    Random(const uint64_t seed, const uint64_t index)
+        : m_Counter(Mix(seed ^ Mix(index + Increment)))
+    {}
+
+    uint64_t Next()
+    {
+        m_Counter += Increment;
+        return Mix(m_Counter);
+    }
+
+    // [0, bound) の一様乱数（掛け算で範囲を縮めるだけなので、偏りは bound / 2^32 以下）
+    uint32_t Below(const uint32_t bound)
+    {
+        return static_cast<uint32_t>(((Next() >> 32) * bound) >> 32);
+    }
+
+    // [min, max] の一様乱数
+    int Range(const int min, const int max)
+    {
+        return min + static_cast<int>(Below(static_cast<uint32_t>(max - min + 1)));
+    }
+
+    // [0, 1) の一様乱数
+    double NextDouble()
+    {
+        return (Next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // この系列から用途ごとに別の系列を派生させる（元の系列は進めない）
+    Random Split(const uint64_t stream) const
+    {
+        return Random(m_Counter, stream);
+    }
+
+    template <class Iterator>
+    void Shuffle(Iterator first, Iterator last)
+    {
+        for (auto count = last - first; count > 1; --count)
+        {
+            const auto other = Below(static_cast<uint32_t>(count));
+            auto temp = first[count - 1];
+            first[count - 1] = first[other];
+            first[other] = temp;
+        }
+    }
+
+    // 系列の index 番目の値を直接求める（Random(seed) で index + 1 回 Next したものと同じ）
+    static uint64_t At(const uint64_t seed, const uint64_t index)
+    {
+        return Mix(seed + (index + 1) * Increment);
+    }
+
+    static uint64_t Mix(uint64_t value)
+    {
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+        return value ^ (value >> 31);
+    }
+
+private:
+    static constexpr uint64_t Increment = 0x9E3779B97F4A7C15ull;
+
+    uint64_t m_Counter;
+};
+
+} // namespace game
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Field.h"
+#include "GameState.h"
+#include "RouteFinder.h"
+#include "Random.h"
+#include "Terrain.h"
+#include <unordered_map>
+#include <vector>
+
+namespace game
+{
+
+// クリア状態から逆向きに滑らせて問題を作る
+// 逆向きにたどった手順をそのまま戻せば解けるので、作った問題は必ず解ける
+// 一手戻すごとに RouteFinder で最短手数を確かめ、最短手数がちょうど一つ伸びた状態だけを残して次に戻すので、
+// 結果の手数は正確な最短手数になる
+class ReverseGenerator
+{
+public:
+    struct Parameter
+    {
+        Field::CreateParameter field;
+        int pieceNum;
+        int rootNum;            // 逆向きにたどり始めるクリア状態の数
+        int maxDepth;           // 逆向きにたどる最大手数
+        int maxSteps;           // 解いて確かめる状態の数の上限（すべてのクリア状態の合計）
+        int beamWidth;          // 最短手数ごとに残して次に戻す状態の数
+
+        Parameter()
+            : field()
+            , pieceNum(4)
+            , rootNum(64)
+            , maxDepth(40)
+            , maxSteps(65536)
+            , beamWidth(128)
+        {
+
+        }
+    };
+
+    struct Result
+    {
+        int moveCount;          // 最短手数（採用した状態まで逆向きにたどった手数と同じ）
+        size_t visitedStates;   // 最短手数を調べた状態の数
+
+        Result()
+            : moveCount(0)
+            , visitedStates(0)
+        {}
+    };
+
+public:
+    ReverseGenerator();
+    ~ReverseGenerator();
+
+    bool Generate(const Parameter& param, Field& field, Result& result);
+
+private:
+    bool PlaceSolvedPieces(int pieceNum, int* cells);
+    void Walk(const Parameter& param, std::vector<Field::Position>& best, Result& result);
+    void ExpandReverse(const int* cells, std::vector<uint64_t>& next);
+    // 一手進めた状態のうち、調べたものの最短手数の上限の最小値（一つもなければ -1）
+    int GetKnownSuccessorDistance(const int* cells) const;
+    void Normalize(int* cells) const;
+    uint64_t Pack(const int* cells) const;
+    void Unpack(uint64_t state, int* cells) const;
+    bool IsOccupied(const int* cells, int cell) const;
+
+private:
+    Random m_Random;
+    RouteFinder m_Finder;
+    Terrain m_Terrain;
+    std::unordered_map<uint64_t, int> m_Distances;  // 調べた状態ごとの最短手数の上限（解いたものは正確な値）
+    std::vector<uint64_t> m_Predecessors;
+    std::vector<uint64_t> m_Layer;          // 最短手数が同じで、次に一手戻す状態の集まり
+    std::vector<uint64_t> m_NextLayer;
+    int m_Width;
+    int m_PieceCount;
+    int m_Bits;
+};
+
+} // namespace game
@@ -0,0 +1,286 @@
+#include "Symmetry.h"
+
+#include "Random.h"
+#include <cstring>
+
+namespace game
+{
+
+namespace
+{
+
+constexpr int SymmetryPlaneNum = static_cast<int>(Symmetry::Plane::Num);
+
+// 転置前・転置後それぞれの盤面（左右反転した行もあらかじめ作っておき、上下反転は行を逆から読むだけにする）
+struct SymmetryBoard
+{
+    int width;
+    int height;
+    Field::Position goal;
+    Field::Position mainPiece;
+    uint32_t rows[2][SymmetryPlaneNum][Symmetry::MaxSize];    // [左右反転するか][面][行]
+};
+
+uint32_t ReverseBits(uint32_t value)
+{
+    value = ((value >> 1) & 0x55555555u) | ((value & 0x55555555u) << 1);
+    value = ((value >> 2) & 0x33333333u) | ((value & 0x33333333u) << 2);
+    value = ((value >> 4) & 0x0F0F0F0Fu) | ((value & 0x0F0F0F0Fu) << 4);
+    value = ((value >> 8) & 0x00FF00FFu) | ((value & 0x00FF00FFu) << 8);
+    return (value >> 16) | (value << 16);
+}
+
+// 32x32 のビット行列の転置の一段（shift 行離れた行どうしで、shift 幅のブロックを入れ替える）
+template <int Shift, uint32_t Mask>
+inline void TransposeStage(uint32_t* rows)
+{
+    for (int k = 0; k < 32; k += Shift * 2)
+    {
+        for (int j = k; j < k + Shift; ++j)
+        {
+            const uint32_t t = ((rows[j] >> Shift) ^ rows[j + Shift]) & Mask;
+            rows[j] ^= t << Shift;
+            rows[j + Shift] ^= t;
+        }
+    }
+}
+
+// 32x32 のビット行列を転置する（16, 8, 4, 2, 1 のブロック単位で対角を入れ替える）
+void Transpose32(uint32_t* rows)
+{
+    TransposeStage<16, 0x0000FFFFu>(rows);
+    TransposeStage<8, 0x00FF00FFu>(rows);
+    TransposeStage<4, 0x0F0F0F0Fu>(rows);
+    TransposeStage<2, 0x33333333u>(rows);
+    TransposeStage<1, 0x55555555u>(rows);
+}
+
+void FlipPlaneX(const uint32_t* source, const int width, const int height, uint32_t* dest)
+{
+    const int shift = Symmetry::MaxSize - width;
+    for (int y = 0; y < height; ++y)
+    {
+        dest[y] = ReverseBits(source[y]) >> shift;
+    }
+}
+
+// 変換後の y 行目
+inline uint32_t SymmetryRow(const SymmetryBoard& board, const int plane, const uint8_t flip, const int y)
+{
+    return board.rows[flip & Symmetry::FlipX][plane][(flip & Symmetry::FlipY) ? board.height - 1 - y : y];
+}
+
+// 8 セル分のうち type と一致するセルのビットを返す（一致したバイトの最上位ビットを集める）
+inline uint32_t SymmetryMatch8(const uint64_t cells, const Field::CellType type)
+{
+    const uint64_t ones = 0x0101010101010101ull, lows = 0x7F7F7F7F7F7F7F7Full;
+    const uint64_t diff = cells ^ (ones * static_cast<uint8_t>(type));
+    const uint64_t zero = ~(((diff & lows) + lows) | diff | lows);
+    return static_cast<uint32_t>(((zero >> 7) * 0x0102040810204080ull) >> 56);
+}
+
+inline int SymmetryCompare(const int lhs, const int rhs)
+{
+    return lhs < rhs ? -1 : (lhs > rhs ? 1 : 0);
+}
+
+} // namespace
+
+bool Symmetry::Canonical::operator==(const Canonical& other) const
+{
+    return width == other.width && height == other.height
+        && goal.x == other.goal.x && goal.y == other.goal.y
+        && mainPiece.x == other.mainPiece.x && mainPiece.y == other.mainPiece.y
+        && std::memcmp(rows, other.rows, sizeof(rows)) == 0;
+}
+
+bool Symmetry::Canonicalize(const Field& field, Canonical& result)
+{
+    return Canonicalize(field, field.GetPieces(), result);
+}
+
+bool Symmetry::Canonicalize(const Field& field, const std::vector<Field::Position>& pieces, Canonical& result)
+{
+    const int width = field.GetWidth(), height = field.GetHeight();
+    if (width <= 0 || height <= 0 || width > MaxSize || height > MaxSize || pieces.empty())
+    {
+        return false;
+    }
+
+    SymmetryBoard sources[2];
+    SymmetryBoard& base = sources[0];
+    uint32_t (&baseRows)[SymmetryPlaneNum][MaxSize] = base.rows[0];
+    std::memset(baseRows, 0, sizeof(baseRows));
+    base.width = width;
+    base.height = height;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const Field::CellType* row = field.GetRow(y).GetData();
+        uint32_t block = 0, hardFrozen = 0, melted = 0;
+        int x = 0;
+        for (; x + 8 <= width; x += 8)
+        {
+            uint64_t cells;
+            std::memcpy(&cells, row + x, sizeof(cells));
+            block |= SymmetryMatch8(cells, Field::CellType::Block) << x;
+            hardFrozen |= SymmetryMatch8(cells, Field::CellType::HardFrozen) << x;
+            melted |= SymmetryMatch8(cells, Field::CellType::Melted) << x;
+        }
+        for (; x < width; ++x)
+        {
+            const uint32_t bit = 1u << x;
+            block |= row[x] == Field::CellType::Block ? bit : 0;
+            hardFrozen |= row[x] == Field::CellType::HardFrozen ? bit : 0;
+            melted |= row[x] == Field::CellType::Melted ? bit : 0;
+        }
+        baseRows[static_cast<int>(Plane::Block)][y] = block;
+        baseRows[static_cast<int>(Plane::HardFrozen)][y] = hardFrozen;
+        baseRows[static_cast<int>(Plane::Melted)][y] = melted;
+    }
+    base.goal = field.GetGoalPosition();
+    base.mainPiece = pieces[0];
+    for (size_t index = 1; index < pieces.size(); ++index)
+    {
+        baseRows[static_cast<int>(Plane::SubPiece)][pieces[index].y] |= 1u << pieces[index].x;
+    }
+
+    // 空の面はどの変換でも空のままなので、変換も比較も省く
+    int planes[SymmetryPlaneNum];
+    int planeCount = 0;
+    for (int plane = 0; plane < SymmetryPlaneNum; ++plane)
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            if (baseRows[plane][y] != 0)
+            {
+                planes[planeCount++] = plane;
+                break;
+            }
+        }
+    }
+
+    // 転置は一度だけ行い、転置前後それぞれに左右反転した行を用意する
+    SymmetryBoard& transposed = sources[1];
+    transposed.width = height;
+    transposed.height = width;
+    transposed.goal = Field::Position(base.goal.y, base.goal.x);
+    transposed.mainPiece = Field::Position(base.mainPiece.y, base.mainPiece.x);
+    for (int index = 0; index < planeCount; ++index)
+    {
+        const int plane = planes[index];
+        std::memcpy(transposed.rows[0][plane], baseRows[plane], sizeof(baseRows[plane]));
+        Transpose32(transposed.rows[0][plane]);
+        FlipPlaneX(base.rows[0][plane], base.width, base.height, base.rows[FlipX][plane]);
+        FlipPlaneX(transposed.rows[0][plane], transposed.width, transposed.height, transposed.rows[FlipX][plane]);
+    }
+
+    // 盤面サイズ、各面の行、ゴール、メインピースの順に比べ、最小のものを正規形とする
+    // 行は一行ずつ比べ、差が付いた時点で打ち切る
+    uint8_t bestTransform = 0;
+    Field::Position bestGoal = base.goal, bestMain = base.mainPiece;
+
+    for (uint8_t transform = 1; transform < 8; ++transform)
+    {
+        const SymmetryBoard& source = sources[(transform & Transpose) ? 1 : 0];
+        const SymmetryBoard& best = sources[(bestTransform & Transpose) ? 1 : 0];
+        const uint8_t flip = transform & (FlipX | FlipY);
+        const uint8_t bestFlip = bestTransform & (FlipX | FlipY);
+
+        int order = SymmetryCompare(source.width, best.width);
+        if (order == 0)
+        {
+            order = SymmetryCompare(source.height, best.height);
+        }
+        for (int index = 0; index < planeCount && order == 0; ++index)
+        {
+            for (int y = 0; y < source.height; ++y)
+            {
+                const uint32_t lhs = SymmetryRow(source, planes[index], flip, y);
+                const uint32_t rhs = SymmetryRow(best, planes[index], bestFlip, y);
+                if (lhs != rhs)
+                {
+                    order = lhs < rhs ? -1 : 1;
+                    break;
+                }
+            }
+        }
+        if (order > 0)
+        {
+            continue;
+        }
+
+        const Field::Position goal = TransformPosition(source.goal, source.width, source.height, flip);
+        const Field::Position main = TransformPosition(source.mainPiece, source.width, source.height, flip);
+        if (order == 0)
+        {
+            order = SymmetryCompare(goal.y * MaxSize + goal.x, bestGoal.y * MaxSize + bestGoal.x);
+        }
+        if (order == 0)
+        {
+            order = SymmetryCompare(main.y * MaxSize + main.x, bestMain.y * MaxSize + bestMain.x);
+        }
+        if (order < 0)
+        {
+            bestTransform = transform;
+            bestGoal = goal;
+            bestMain = main;
+        }
+    }
+
+    const SymmetryBoard& best = sources[(bestTransform & Transpose) ? 1 : 0];
+    const uint8_t bestFlip = bestTransform & (FlipX | FlipY);
+    result.width = best.width;
+    result.height = best.height;
+    result.transform = bestTransform;
+    result.goal = bestGoal;
+    result.mainPiece = bestMain;
+    std::memset(result.rows, 0, sizeof(result.rows));
+
+    // 面は二行ずつまとめて混ぜる
+    uint64_t hash = Random::Mix((static_cast<uint64_t>(best.width) << 32) | static_cast<uint64_t>(best.height));
+    hash = Random::Mix(hash ^ ((static_cast<uint64_t>(bestGoal.y * MaxSize + bestGoal.x) << 32)
+        | static_cast<uint64_t>(bestMain.y * MaxSize + bestMain.x)));
+    for (int index = 0; index < planeCount; ++index)
+    {
+        const int plane = planes[index];
+        uint32_t* rows = result.rows[plane];
+        for (int y = 0; y < best.height; ++y)
+        {
+            rows[y] = SymmetryRow(best, plane, bestFlip, y);
+        }
+
+        hash = Random::Mix(hash ^ static_cast<uint64_t>(plane + 1));
+        for (int y = 0; y < best.height; y += 2)
+        {
+            // 盤面の外の行は 0 なので、高さが奇数でも最後の行と 0 を組にすればよい
+            hash = Random::Mix(hash ^ ((static_cast<uint64_t>(rows[y]) << 32) | rows[y + 1]));
+        }
+    }
+    result.hash = hash;
+
+    return true;
+}
+
+Field::Position Symmetry::TransformPosition(const Field::Position& position, const int width, const int height, const uint8_t transform)
+{
+    Field::Position result = position;
+    int resultWidth = width, resultHeight = height;
+    if (transform & Transpose)
+    {
+        result = Field::Position(position.y, position.x);
+        resultWidth = height;
+        resultHeight = width;
+    }
+    if (transform & FlipX)
+    {
+        result.x = resultWidth - 1 - result.x;
+    }
+    if (transform & FlipY)
+    {
+        result.y = resultHeight - 1 - result.y;
+    }
+    return result;
+}
+
+} // namespace game
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Field.h"
+#include <cinttypes>
+#include <vector>
+
+namespace game
+{
+
+// 盤面の回転・反転（8 通り）を同一視した正規形を求める
+// 各セルの種類とピースの位置を行ごとのビット列に詰め、転置と左右・上下反転をビット演算で行う
+// 正規形は 8 通りのうち辞書順で最小のもので、そのハッシュを盤面の重複除去に使う
+class Symmetry
+{
+public:
+    // 一行を 32bit に詰めるため、縦横ともにこれ以下の盤面のみ扱える
+    static constexpr int MaxSize = 32;
+
+    // 行ごとのビット列で持つセルの種類（ゴールとメインピースは一つしかないので座標で持つ）
+    enum class Plane : uint8_t
+    {
+        Block,          // Block
+        HardFrozen,     // HardFrozen
+        Melted,         // Melted
+        SubPiece,       // サブピース（区別しない）
+        Num,
+    };
+
+    // 変換は「転置してから左右反転、上下反転」の順に、それぞれ行うかどうかのビットで表す
+    enum TransformBit : uint8_t
+    {
+        FlipX = 1 << 0,
+        FlipY = 1 << 1,
+        Transpose = 1 << 2,
+    };
+
+    struct Canonical
+    {
+        int width;
+        int height;
+        uint8_t transform;      // 元の盤面からこの形にする変換（TransformBit の組み合わせ）
+        uint64_t hash;
+        Field::Position goal;
+        Field::Position mainPiece;
+        uint32_t rows[static_cast<int>(Plane::Num)][MaxSize];
+
+        Canonical()
+            : width(0)
+            , height(0)
+            , transform(0)
+            , hash(0)
+            , goal()
+            , mainPiece()
+            , rows()
+        {}
+
+        bool operator==(const Canonical& other) const;
+    };
+
+public:
+    static bool Canonicalize(const Field& field, Canonical& result);
+    static bool Canonicalize(const Field& field, const std::vector<Field::Position>& pieces, Canonical& result);
+
+    // 変換後の座標を求める（ピースの手順などを正規形に合わせる場合に使う）
+    static Field::Position TransformPosition(const Field::Position& position, int width, int height, uint8_t transform);
+};
+
+} // namespace game
@@ -1,34 +1,62 @@
 #include "Utility.h"
 
+#include <cstring>
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define GAME_UTILITY_SSE2 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
 namespace
 {
 
-int ctoi(const char c)
+constexpr char RunDigits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+static_assert(sizeof(RunDigits) - 1 == game::Utility::MaxRunLength, "one digit per run length");
+
+#if defined(GAME_UTILITY_SSE2)
+// 0 でない mask の最下位の立っているビットの位置
+int CountTrailingZeros(const uint32_t mask)
 {
-    switch (c)
-    {
-    case '0': return  0; case '1': return  1; case '2': return  2; case '3': return  3; case '4': return  4; case '5': return  5;
-    case '6': return  6; case '7': return  7; case '8': return  8; case '9': return  9; case 'a': return 10; case 'b': return 11;
-    case 'c': return 12; case 'd': return 13; case 'e': return 14; case 'f': return 15; case 'g': return 16; case 'h': return 17;
-    case 'i': return 18; case 'j': return 19; case 'k': return 20; case 'l': return 21; case 'm': return 22; case 'n': return 23;
-    case 'o': return 24; case 'p': return 25; case 'q': return 26; case 'r': return 27; case 's': return 28; case 't': return 29;
-    case 'u': return 30; case 'v': return 31; case 'w': return 32; case 'x': return 33; case 'y': return 34; case 'z': return 35;
-    }
-    return 0;
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(mask);
+#endif
 }
+#endif
 
-char itoc(const int i)
+// index から数えて c が続く並びの終わり
+// 盤面の並びはほとんどが数文字で終わるので、先頭の数文字を見てから 16 文字ずつ比べる
+size_t FindRunEnd(const char* src, size_t index, const size_t size, const char c)
 {
-    switch (i)
+#if defined(GAME_UTILITY_SSE2)
+    for (const size_t head = index + 8 < size ? index + 8 : size; index < head; ++index)
+    {
+        if (src[index] != c)
+        {
+            return index;
+        }
+    }
+    const __m128i pattern = _mm_set1_epi8(c);
+    for (; index + 16 <= size; index += 16)
     {
-    case  0: return '0'; case  1: return '1'; case  2: return '2'; case  3: return '3'; case  4: return '4'; case  5: return '5';
-    case  6: return '6'; case  7: return '7'; case  8: return '8'; case  9: return '9'; case 10: return 'a'; case 11: return 'b';
-    case 12: return 'c'; case 13: return 'd'; case 14: return 'e'; case 15: return 'f'; case 16: return 'g'; case 17: return 'h';
-    case 18: return 'i'; case 19: return 'j'; case 20: return 'k'; case 21: return 'l'; case 22: return 'm'; case 23: return 'n';
-    case 24: return 'o'; case 25: return 'p'; case 26: return 'q'; case 27: return 'r'; case 28: return 's'; case 29: return 't';
-    case 30: return 'u'; case 31: return 'v'; case 32: return 'w'; case 33: return 'x'; case 34: return 'y'; case 35: return 'z';
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + index));
+        const uint32_t differ = ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, pattern))) & 0xFFFF;
+        if (differ != 0)
+        {
+            return index + CountTrailingZeros(differ);
+        }
     }
-    return '0';
+#endif
+    while (index < size && src[index] == c)
+    {
+        ++index;
+    }
+    return index;
 }
 
 }
@@ -36,58 +64,155 @@ char itoc(const int i)
 namespace game
 {
 
-const std::string& Utility::EncodeRunLength(const std::string& src, std::string& dst)
+constexpr Utility::RunCountTable Utility::MakeRunCountTable()
 {
-    dst.clear();
+    RunCountTable table = {};
+    for (int c = 0; c < 256; ++c)
+    {
+        table.value[c] = -1;
+    }
+    for (int count = 0; count < MaxRunLength; ++count)
+    {
+        table.value[static_cast<uint8_t>(RunDigits[count])] = static_cast<int8_t>(count);
+    }
+    return table;
+}
 
-    const char* p = src.c_str();
-    char basec = p[0];
+// 起動時の初期化を待たないよう、定数式で作る
+const Utility::RunCountTable Utility::s_RunCounts = MakeRunCountTable();
 
-    int count = 0;
-    for (size_t index = 1, size = src.length(); index < size; ++index)
+size_t Utility::EncodeRunLength(const char* src, const size_t size, char* dst)
+{
+    char* const begin = dst;
+    for (size_t index = 0; index < size;)
     {
-        if (basec == p[index] && count < 36) // 36 i
+        const char c = src[index];
+        const size_t end = FindRunEnd(src, index + 1, size, c);
+        size_t run = end - index;
+        for (; run > MaxRunLength; run -= MaxRunLength)
         {
-            ++count;
-        }
-        else
-        {
-            dst.push_back(basec);
-            dst.push_back(itoc(count));
-            count = 0;
-
-            basec = p[index];
+            dst[0] = c;
+            dst[1] = RunDigits[MaxRunLength - 1];
+            dst += 2;
         }
+        dst[0] = c;
+        dst[1] = RunDigits[run - 1];
+        dst += 2;
+        index = end;
     }
-
-    dst.push_back(basec);
-    dst.push_back(itoc(count));
-
-    return dst;
+    return static_cast<size_t>(dst - begin);
 }
 
-const std::string& Utility::DecodeRunLength(const std::string& src, std::string& dst)
+size_t Utility::DecodeRunLength(const char* src, const size_t size, char* dst, const size_t capacity)
 {
-    dst.clear();
+    if (size % 2 != 0)
+    {
+        return 0;
+    }
 
-    const char* p = src.c_str();
-    char basec = p[0];
+    char* const begin = dst;
+    char* const end = dst + capacity;
+    for (const char* p = src, *last = src + size; p < last; p += 2)
+    {
+        const int run = DecodeRunCount(p[1]) + 1;
+        if (run <= 0 || run > end - dst)
+        {
+            return 0;
+        }
+#if defined(GAME_UTILITY_SSE2)
+        // 余裕があれば一組分（最大 36 文字）をまとめて 48 文字書き、はみ出した分は次の組で上書きする
+        static_assert(MaxRunLength <= 48, "a run must fit in three stores");
+        if (end - dst >= 48)
+        {
+            const __m128i fill = _mm_set1_epi8(p[0]);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), fill);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), fill);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 32), fill);
+            dst += run;
+            continue;
+        }
+#endif
+        std::memset(dst, p[0], run);
+        dst += run;
+    }
+    return static_cast<size_t>(dst - begin);
+}
 
-    int count = 0;
+void Utility::EncodeByteRuns(const uint8_t* src, const size_t size, std::vector<uint8_t>& dst)
+{
+    const char* const chars = reinterpret_cast<const char*>(src);
+    for (size_t index = 0; index < size;)
+    {
+        const uint8_t value = src[index];
+        const size_t end = FindRunEnd(chars, index + 1, size, chars[index]);
+        size_t run = end - index;
+        for (; run > MaxByteRunLength; run -= MaxByteRunLength)
+        {
+            dst.push_back(static_cast<uint8_t>((value << 5) | (MaxByteRunLength - 1)));
+        }
+        dst.push_back(static_cast<uint8_t>((value << 5) | (run - 1)));
+        index = end;
+    }
+}
 
-    for (size_t index = 1, size = src.length(); index < size; ++index)
+const uint8_t* Utility::DecodeByteRuns(const uint8_t* src, const uint8_t* end, uint8_t* dst, const size_t size, size_t* counts)
+{
+    static_assert(ByteRunValueNum * MaxByteRunLength == 256, "a run fills one byte");
+    uint8_t* const last = dst + size;
+    while (dst < last)
     {
-        dst.push_back(basec);
-        int loop = ::ctoi(p[index]);
-        while (loop-- > 0)
+        if (src == end)
+        {
+            return nullptr;
+        }
+        const uint8_t value = static_cast<uint8_t>(*src >> 5);
+        const int run = (*src & (MaxByteRunLength - 1)) + 1;
+        ++src;
+        if (run > last - dst)
+        {
+            return nullptr;
+        }
+        counts[value] += run;
+#if defined(GAME_UTILITY_SSE2)
+        // 余裕があれば一バイト分（最大 32 個）をまとめて 32 バイト書き、はみ出した分は次のバイトで上書きする
+        if (last - dst >= MaxByteRunLength)
         {
-            dst.push_back(basec);
+            const __m128i fill = _mm_set1_epi8(static_cast<char>(value));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), fill);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), fill);
+            dst += run;
+            continue;
         }
+#endif
+        std::memset(dst, value, run);
+        dst += run;
+    }
+    return src;
+}
 
-        basec = p[++index];
+void Utility::WriteVarint(uint64_t value, std::vector<uint8_t>& dst)
+{
+    while (value >= 0x80)
+    {
+        dst.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
     }
+    dst.push_back(static_cast<uint8_t>(value));
+}
 
-    return dst;
+const uint8_t* Utility::ReadVarint(const uint8_t* src, const uint8_t* end, uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; src < end && shift < 64; shift += 7)
+    {
+        const uint8_t byte = *src++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return src;
+        }
+    }
+    return nullptr;
 }
 
 }
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "CellIndex.h"
+#include "Random.h"
+#include <cinttypes>
+
+namespace game
+{
+
+// Zobrist ハッシュの鍵
+// 鍵の表は持たず、(セル, 種類) を番号にしてカウンタベースの乱数（Random::At）から直接求める
+// 表を引くのと変わらない手間で求まり、盤面の大きさに上限がなく、処理系が変わっても同じ値になる
+// 盤面やピースの状態は、含まれる鍵の排他的論理和をハッシュとし、一か所変わるごとに二つの鍵を xor して更新する
+class Zobrist
+{
+public:
+    // セルの種類が取りうる値の数（Field::CellType が収まること）
+    static constexpr int CellTypeNum = 8;
+
+    // cell が type であることの鍵
+    static uint64_t Cell(const CellIndex cell, const int type)
+    {
+        return Random::At(CellSeed, static_cast<uint64_t>(cell) * CellTypeNum + type);
+    }
+
+    // piece 番目のピースが cell にいることの鍵（サブピースは区別しないので、鍵はメインピースとサブピースの二通り）
+    static uint64_t Piece(const int piece, const CellIndex cell)
+    {
+        return piece == 0 ? Random::At(MainPieceSeed, cell) : Random::At(SubPieceSeed, cell);
+    }
+
+    // セルの種類が変わったときのハッシュ
+    static uint64_t ChangeCell(const uint64_t hash, const CellIndex cell, const int before, const int after)
+    {
+        return hash ^ Cell(cell, before) ^ Cell(cell, after);
+    }
+
+    // ピースが動いたときのハッシュ
+    static uint64_t MovePiece(const uint64_t hash, const int piece, const CellIndex from, const CellIndex to)
+    {
+        return hash ^ Piece(piece, from) ^ Piece(piece, to);
+    }
+
+private:
+    static constexpr uint64_t CellSeed = 0x5A0B1C2D3E4F6071ull;
+    static constexpr uint64_t MainPieceSeed = 0x1F2E3D4C5B6A7988ull;
+    static constexpr uint64_t SubPieceSeed = 0x7766554433221100ull;
+};
+
+} // namespace game
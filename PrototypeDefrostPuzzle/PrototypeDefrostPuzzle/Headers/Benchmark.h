@@ -0,0 +1,14 @@
+#pragma once
+
+namespace prototype
+{
+
+// コマンドライン引数で指定された計測を実行する
+class Benchmark
+{
+public:
+    static int SolverKernel(int argc, char** argv);
+    static int FieldStorage(int argc, char** argv);
+};
+
+} // namespace prototype
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cinttypes>
+
+namespace game
+{
+
+// 盤面のセル番号（y * 幅 + x）
+// ゲーム側とのやり取りはすべてこれで行い、(x, y) に直すのは表示するときだけにする
+typedef uint16_t CellIndex;
+
+// どのセルも指さない
+constexpr CellIndex InvalidCellIndex = 0xFFFF;
+
+constexpr CellIndex MakeCellIndex(const int x, const int y, const int width)
+{
+    return static_cast<CellIndex>(y * width + x);
+}
+
+constexpr int GetCellColumn(const CellIndex cell, const int width)
+{
+    return cell % width;
+}
+
+constexpr int GetCellRow(const CellIndex cell, const int width)
+{
+    return cell / width;
+}
+
+// セル番号 4 つ（ピース 4 つ分）を 64bit の一語に詰めたもの、0 番が下位
+typedef uint64_t PieceSet;
+
+constexpr int PieceSetCapacity = 4;
+
+constexpr CellIndex GetPieceSetCell(const PieceSet pieces, const int index)
+{
+    return static_cast<CellIndex>(pieces >> (index * 16));
+}
+
+constexpr PieceSet SetPieceSetCell(const PieceSet pieces, const int index, const CellIndex cell)
+{
+    return (pieces & ~(static_cast<PieceSet>(0xFFFF) << (index * 16))) | (static_cast<PieceSet>(cell) << (index * 16));
+}
+
+} // namespace game
@@ -1,13 +1,18 @@
 #pragma once
 
+#include "Random.h"
+#include "Zobrist.h"
 #include <cinttypes>
 #include <vector>
-#include <functional>
+#include <memory>
 #include <string>
 
 namespace game
 {
 
+// セルは複製した Field と共有し、どちらかが書き換えるときに初めて複製する（複製は O(1)）
+// セルとメインピースの位置の Zobrist ハッシュを持ち、セルを書き換えるたびに O(1) で更新する
+// （作り直したときは最初に GetHash するまで求めないので、読み込むだけの盤面には手間がかからない）
 class Field
 {
 public:
@@ -19,23 +24,113 @@ public:
         Block,
         Piece,
         Goal,
+        Cracked,    // ピースがぶつかってひびが入った HardFrozen（MeltSimulation だけが作り、盤面の文字列や保存形式には現れない）
     };
 
     struct CreateParameter
     {
+        // seed を指定し忘れたことを見分けるための既定値（seed には使えない）
+        static constexpr uint64_t UnsetSeed = ~0ull;
+
         int width;
         int height;
         int level;
+        uint64_t seed;      // 同じ seed と index からは常に同じ盤面が作られる（呼び出し側が必ず指定し、UnsetSeed のまま Create すると _ASSERT で止まる）
+        uint64_t index;     // seed の中での盤面の番号
 
         CreateParameter()
             : width(20)
             , height(20)
             , level(6)
+            , seed(UnsetSeed)
+            , index(0)
         {
 
         }
     };
 
+    enum class Direction : uint8_t
+    {
+        Up,
+        Left,
+        Right,
+        Down,
+        Num,
+    };
+
+    // 連続したセルの並びを指す（一行分や盤面全体）
+    template <typename T>
+    class Span
+    {
+    public:
+        Span()
+            : m_Data(nullptr)
+            , m_Size(0)
+        {}
+        Span(T* data, int size)
+            : m_Data(data)
+            , m_Size(size)
+        {}
+
+        T* GetData() const { return m_Data; }
+        int GetSize() const { return m_Size; }
+        T& operator[](int index) const { return m_Data[index]; }
+        T* begin() const { return m_Data; }
+        T* end() const { return m_Data + m_Size; }
+
+    private:
+        T* m_Data;
+        int m_Size;
+    };
+    using ConstRow = Span<const CellType>;
+
+    // 上の行から順に ConstRow を返す範囲（for (const auto row : field.Rows()) で回す）
+    class RowRange
+    {
+    public:
+        class Iterator
+        {
+        public:
+            Iterator(const CellType* row, int width)
+                : m_Row(row)
+                , m_Width(width)
+            {}
+
+            ConstRow operator*() const { return ConstRow(m_Row, m_Width); }
+            Iterator& operator++() { m_Row += m_Width; return *this; }
+            bool operator!=(const Iterator& other) const { return m_Row != other.m_Row; }
+
+        private:
+            const CellType* m_Row;
+            int m_Width;
+        };
+
+        RowRange(const CellType* cells, int width, int height)
+            : m_Cells(cells)
+            , m_Width(width)
+            , m_Height(height)
+        {}
+
+        Iterator begin() const { return Iterator(m_Cells, m_Width); }
+        Iterator end() const { return Iterator(m_Cells + m_Width * m_Height, m_Width); }
+
+    private:
+        const CellType* m_Cells;
+        int m_Width;
+        int m_Height;
+    };
+
+    // CreateFromText の結果
+    enum class ParseError : uint8_t
+    {
+        None,
+        Format,     // "幅,高さ,セル" の形になっていない
+        Size,       // 幅か高さが 0、またはセル番号が CellIndex に収まらない
+        Cell,       // セルの種類でもピースでもない文字がある
+        Length,     // セルの数が幅 * 高さと合わない
+        Piece,      // ピースが重なっているか、番号が飛んでいる
+    };
+
     struct Position
     {
         int x;
@@ -53,29 +148,97 @@ public:
 
 public:
     Field();
+    Field(const Field& other) = default;
+    Field(Field&& other) noexcept;
     ~Field();
 
+    Field& operator=(const Field& other) = default;
+    Field& operator=(Field&& other) noexcept;
+
     bool Create(const CreateParameter& param);
     bool CreateFromString(const char* serialized);
+    // Serialize で書いた文字列（終端は不要）を一度だけ走査して作る
+    // セルとピースの領域は使い回し、確保は起きない（失敗したときの中身は不定）
+    ParseError CreateFromText(const char* text, size_t length);
+    // SerializeBinary で書いたものから作る（読んだバイト数を返し、壊れていれば 0）
+    // ピースが重なっているもの、Piece でないセルにピースがあるもの、ピースの乗らない Piece のセルがあるもの、
+    // Goal のセルがちょうど一つでないものも壊れているとみなす
+    // セルとピースの領域は使い回すので、同じ大きさの盤面を読み続ける限り確保は起きない（失敗したときの中身は不定）
+    size_t CreateFromBinary(const uint8_t* data, size_t size);
+    // 行優先に並んだセルとピースの位置から作る（ピースの位置のセルは Piece にする）
+    bool CreateFromCells(int width, int height, const CellType* cells, const std::vector<Position>& pieces);
     void Destroy();
-    void Dump(std::function<void(const CellType**, int, int)> dumper);
-    void PutPieces(std::vector<Position>& pieces, int putNum);
+    // すべてのセルを上の行から順に visitor(x, y, cell) で訪れる（呼び出し側でインライン展開される）
+    template <typename Visitor>
+    void ForEachCell(Visitor&& visitor) const
+    {
+        for (int y = 0; y < m_Height; ++y)
+        {
+            const CellType* row = GetRow(y).GetData();
+            for (int x = 0; x < m_Width; ++x)
+            {
+                visitor(x, y, row[x]);
+            }
+        }
+    }
+    bool PutPieces(std::vector<Position>& pieces, int putNum);
+    void SetPieces(const std::vector<Position>& pieces);
     CellType GetCell(int x, int y) const;
+    // y 行目のセル（行は m_Width おきに連続して並んでいる）
+    ConstRow GetRow(int y) const { return ConstRow(m_Cells->data() + y * m_Width, m_Width); }
+    // 行優先に並んだ全セル
+    ConstRow GetCells() const { return m_Cells ? ConstRow(m_Cells->data(), static_cast<int>(m_Cells->size())) : ConstRow(); }
+    RowRange Rows() const { return RowRange(GetCells().GetData(), m_Width, m_Height); }
+    // セルを他の Field と共有しているか（共有している間は書き換えると複製される）
+    bool IsCellsShared() const { return m_Cells.use_count() > 1; }
+    long GetCellsUseCount() const { return m_Cells.use_count(); }
+    void SetCell(int x, int y, CellType cellType);
     Position GetGoalPosition() const;
-    void Serialize(std::string& dist);
+    const std::vector<Position>& GetPieces() const;
+    int32_t GetWidth() const { return m_Width; }
+    int32_t GetHeight() const { return m_Height; }
+    // 盤面の Zobrist ハッシュ（探索結果のキャッシュや重複除去のキーに使う）
+    uint64_t GetHash() const
+    {
+        if (!m_HashValid)
+        {
+            m_Hash = ComputeHash();
+            m_HashValid = true;
+        }
+        return m_Hash;
+    }
+    // ハッシュを全セルから求め直す（GetHash と一致する）
+    uint64_t ComputeHash() const;
+    void Serialize(std::string& dist) const;
+    // バイナリ形式で dist の末尾に書き足す
+    //   varint 版 | varint 幅 | varint 高さ | varint ピース数 | セル（Utility::EncodeByteRuns のランレングス）| varint ピースのセル番号 * ピース数
+    void SerializeBinary(std::vector<uint8_t>& dist) const;
+
+    static constexpr uint32_t BinaryVersion = 2;
 
 private:
     void CreateField(int width, int height);
     void DestroyField();
-    void CreateIsland(int islandNum);
+    bool CreateIsland(int islandNum);
     void FillField(const CellType cellType);
+    void DetachCells();
+    // セルを書き換えてハッシュを更新する（DetachCells の後で呼ぶ）
+    void ChangeCell(int x, int y, CellType cellType);
+    // メインピースの鍵を付け外しする（m_Pieces を変える前後に呼ぶ）
+    void ToggleMainPieceHash();
+    // 書き込みは DetachCells の後で行う
+    CellType& At(int x, int y) { return (*m_Cells)[y * m_Width + x]; }
+    CellType At(int x, int y) const { return (*m_Cells)[y * m_Width + x]; }
 
 private:
-    CellType** m_Field;
+    std::shared_ptr<std::vector<CellType>> m_Cells;  // 行優先で一続きに確保する
     int32_t m_Width;
     int32_t m_Height;
     Position m_Goal;
     std::vector<Position> m_Pieces;
+    mutable uint64_t m_Hash;
+    mutable bool m_HashValid;           // false の間は書き換えても m_Hash を更新しない
+    Random m_Random;    // Create で (seed, index) から作り、ピースの配置まで使い続ける
 };
 
 } // namespace game
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Field.h"
+#include "GameState.h"
+#include "Occupancy.h"
+#include "RouteFinder.h"
+#include "Terrain.h"
+#include <vector>
+
+namespace game
+{
+
+// 盤面を生成し、最短手数が指定範囲に収まるものだけを採用する
+// 一つのインスタンスは一つのスレッドからのみ使うこと（スレッドごとに用意する）
+class LevelGenerator
+{
+public:
+    struct Parameter
+    {
+        Field::CreateParameter field;
+        int pieceNum;
+        int minMoves;
+        int maxMoves;
+
+        Parameter()
+            : field()
+            , pieceNum(4)
+            , minMoves(1)
+            , maxMoves(30)
+        {
+
+        }
+    };
+
+    enum class Stage : uint8_t
+    {
+        Generate,   // 盤面の生成とピースの配置
+        Screen,     // 解かずに判定できるものを除外
+        Solve,      // 最短手数の探索
+        Accept,     // 範囲内に収まった
+        Num,
+    };
+
+    struct Result
+    {
+        Stage reached;      // どの段階まで進んだか（Accept なら採用）
+        int moveCount;
+
+        Result()
+            : reached(Stage::Generate)
+            , moveCount(0)
+        {}
+    };
+
+public:
+    LevelGenerator();
+    ~LevelGenerator();
+
+    // 候補を一つ作って判定する、採用されたら true
+    bool Generate(const Parameter& param, Field& field, Result& result);
+
+    // 候補を一つずつ段階ごとに進める場合に使う
+    bool CreateCandidate(const Parameter& param, Field& field);
+    bool Screen(const Parameter& param, const Field& field);
+    bool Solve(const Parameter& param, const Field& field, Result& result);
+
+private:
+    int SolveMainPieceOnly(const Terrain& terrain, const GameState& state, int maxMoves);
+
+private:
+    RouteFinder m_Finder;
+    Terrain m_Terrain;
+    Occupancy m_Occupancy;
+    std::vector<int> m_Distance;
+    std::vector<CellIndex> m_Queue;
+};
+
+} // namespace game
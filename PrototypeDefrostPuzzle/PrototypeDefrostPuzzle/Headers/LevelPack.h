@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Field.h"
+#include "Random.h"
+#include <cinttypes>
+#include <cstddef>
+#include <vector>
+
+namespace game
+{
+
+// 多数の盤面をまとめたバイナリ形式（レベルパック）
+//
+//   Header | Bucket[bucketNum] | Entry[levelNum] | 盤面データ
+//
+// 盤面は難易度（最短手数の範囲）ごとのバケットの順に並べてあり、各バケットは盤面番号の連続した範囲になる
+// 読み込み側はメモリ上の内容をそのまま参照するだけで、開くときに全体を読んだり変換したりしない
+// （数値はすべてリトルエンディアン、各表は 8 バイト境界から始まる）
+class LevelPack
+{
+public:
+    static constexpr uint32_t Version = 3;
+    static constexpr int MaxSize = 255;     // 盤面の縦横の上限（Entry に 1 バイトで持つため）
+    static constexpr uint64_t NoOrigin = ~0ull;    // (seed, index) から作り直せない盤面の Entry::seed と Entry::index
+
+    struct Header
+    {
+        char magic[4];          // "DFPK"
+        uint32_t version;
+        uint32_t levelNum;
+        uint32_t bucketNum;
+        uint32_t bucketOffset;  // ファイル先頭からのバイト数
+        uint32_t entryOffset;
+        uint32_t dataOffset;
+        uint32_t dataSize;
+    };
+
+    struct Bucket
+    {
+        uint16_t minMoves;      // このバケットに入る最短手数の範囲 [minMoves, maxMoves]
+        uint16_t maxMoves;
+        uint32_t first;         // 最初の盤面の番号
+        uint32_t count;
+    };
+
+    struct Entry
+    {
+        uint64_t seed;          // 盤面を作ったときの (seed, index)（作り直しや不具合の報告に使う）
+        uint64_t index;
+        uint32_t dataOffset;    // 盤面データの先頭からのバイト数
+        uint16_t moveCount;     // 最短手数
+        uint16_t solutionCount; // 最短解の数
+        uint8_t width;
+        uint8_t height;
+        uint8_t pieceNum;
+        uint8_t bucket;
+        uint32_t dataSize;      // 盤面データのバイト数
+    };
+
+    // 盤面データは Field::SerializeBinary の形式で、Load はそこから一時領域を介さずに Field を作る
+
+public:
+    LevelPack();
+    ~LevelPack();
+
+    // data は閉じるまで（またはこのオブジェクトが消えるまで）そのまま参照し続ける
+    bool Open(const void* data, size_t size);
+    void Close();
+    bool IsOpen() const { return m_Header != nullptr; }
+
+    uint32_t GetLevelNum() const { return m_Header ? m_Header->levelNum : 0; }
+    uint32_t GetBucketNum() const { return m_Header ? m_Header->bucketNum : 0; }
+    const Bucket& GetBucket(uint32_t bucket) const { return m_Buckets[bucket]; }
+    const Entry& GetEntry(uint32_t level) const { return m_Entries[level]; }
+
+    // 最短手数が入るバケット（どれにも入らなければ -1）
+    int FindBucket(int moveCount) const;
+    // バケットの中から一つ選ぶ（空のバケットなら false）
+    bool PickLevel(uint32_t bucket, Random& random, uint32_t& level) const;
+
+    bool Load(uint32_t level, Field& field) const;
+
+private:
+    const Header* m_Header;
+    const Bucket* m_Buckets;
+    const Entry* m_Entries;
+    const uint8_t* m_Data;
+};
+
+// レベルパックを作る（盤面を追加してから、バケットの区切りを指定して書き出す）
+class LevelPackBuilder
+{
+public:
+    LevelPackBuilder();
+    ~LevelPackBuilder();
+
+    bool Add(const Field& field, int moveCount, int solutionCount, uint64_t seed, uint64_t index);
+    size_t GetLevelNum() const { return m_Entries.size(); }
+
+    // bucketMinMoves はバケットごとの最短手数の下限（昇順）で、最初の下限より短い盤面は入れない
+    // 盤面はバケットの順に並べ替え、同じバケットの中では追加した順を保つ
+    void Build(const std::vector<int>& bucketMinMoves, std::vector<uint8_t>& output) const;
+
+private:
+    std::vector<LevelPack::Entry> m_Entries;
+    std::vector<uint8_t> m_Data;
+};
+
+} // namespace game
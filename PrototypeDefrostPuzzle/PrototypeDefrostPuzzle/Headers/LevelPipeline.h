@@ -0,0 +1,34 @@
+#pragma once
+
+namespace prototype
+{
+
+// 複数スレッドで盤面の生成と検証を行い、条件を満たした盤面のコードを出力する
+//   generate <count> <minMoves> <maxMoves> [threads] [output] [seed]
+//   reverse <count> [maxDepth] [output] [seed]
+//   optimize <count> [iterations] [output] [seed]
+// 出力の最後の列は盤面の番号で、同じシードと番号から同じ盤面を作り直せる
+//   dedup <input> [output]
+// 上の出力から、回転・反転で重なる盤面を取り除く（最初に出てきたものを残す）
+//   cluster <input> [output] [threshold]
+// 似た盤面を組にまとめ、行の最後に組の代表（入力の何番目の盤面か）を付けて出力する
+//   pack <input> <output> <seed> [bucketMinMoves...]
+// 上の出力を解き直して、難易度ごとのバケットに分けたレベルパックを作る（seed は出力を作ったときのもの）
+//   pack-info <pack> [samples]
+// レベルパックを割り当てて開き、各バケットから選んだ盤面を解いて手数を確かめる
+//   estimate <input> [playouts] [maxMoves] [greedy] [output]
+// ランダムなプレイアウトで難しさを見積もり、最後の列（番号）の前に成功率と平均手数を加えて出力する
+class LevelPipeline
+{
+public:
+    static int Run(int argc, char** argv);
+    static int RunReverse(int argc, char** argv);
+    static int RunOptimize(int argc, char** argv);
+    static int RunDedup(int argc, char** argv);
+    static int RunCluster(int argc, char** argv);
+    static int RunPack(int argc, char** argv);
+    static int RunPackInfo(int argc, char** argv);
+    static int RunEstimate(int argc, char** argv);
+};
+
+} // namespace prototype
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+
+namespace prototype
+{
+
+// ファイルを読み込み専用でメモリに割り当てる（レベルパックをコピーせずに参照するため）
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool Open(const char* path);
+    void Close();
+
+    const void* GetData() const { return m_Data; }
+    size_t GetSize() const { return m_Size; }
+
+private:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+private:
+    const void* m_Data;
+    size_t m_Size;
+#if defined(_WIN32)
+    void* m_File;
+    void* m_Mapping;
+#endif
+};
+
+} // namespace prototype
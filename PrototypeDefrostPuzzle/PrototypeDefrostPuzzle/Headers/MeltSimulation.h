@@ -0,0 +1,70 @@
+#pragma once
+
+#include "CellIndex.h"
+#include "Field.h"
+#include "Terrain.h"
+#include <cinttypes>
+#include <vector>
+
+namespace game
+{
+
+// ピースが滑って通ったセルの氷を溶かす
+// Frozen は一度通ると Melted になる
+// HardFrozen は通れず、滑ってきたピースがぶつかって止まると Cracked になる（Cracked も通れないままなので、見た目も壁として描く）
+// 一手ごとに変わったセルだけを返すので、表示側はそのセルだけを描き直せばよく、手間は滑った距離に比例する
+// 溶け具合はピースの動きには関わらない（止まる位置は Terrain のまま変わらない）
+class MeltSimulation
+{
+public:
+    struct Change
+    {
+        CellIndex cell;
+        Field::CellType before;
+        Field::CellType after;
+
+        Change()
+            : cell(InvalidCellIndex)
+            , before(Field::CellType::Frozen)
+            , after(Field::CellType::Frozen)
+        {}
+        Change(CellIndex cell, Field::CellType before, Field::CellType after)
+            : cell(cell)
+            , before(before)
+            , after(after)
+        {}
+    };
+    using ChangeList = std::vector<Change>;
+
+public:
+    MeltSimulation();
+    ~MeltSimulation();
+
+    // 地形のセルから始める（これまでの手はすべて捨てる）
+    void Reset(const Terrain& terrain);
+    // from から to まで一直線に滑ったものとして、to の手前までのセルを溶かし、to の先でぶつかった HardFrozen を Cracked にする
+    // from と to が同じ行にも同じ列にもなければ何も溶かさない（一手として数えるので、Undo と対になる）
+    const ChangeList& Step(CellIndex from, CellIndex to);
+    // 最後の一手で溶かしたセルを元に戻す（戻したセルを返す）
+    const ChangeList& Undo();
+    // すべての手を戻す（戻したセルを返す）
+    const ChangeList& Rewind();
+
+    Field::CellType GetCell(CellIndex cell) const { return m_Cells[cell]; }
+    int GetStepNum() const { return static_cast<int>(m_StepBegins.size()); }
+    // これまでに Melted になったセルの数
+    int GetMeltedNum() const { return m_MeltedNum; }
+
+private:
+    void Revert(size_t begin);
+
+private:
+    int32_t m_Width;
+    int m_MeltedNum;
+    std::vector<Field::CellType> m_Cells;
+    ChangeList m_Log;                   // すべての手の変更を手の順に並べる
+    std::vector<uint32_t> m_StepBegins; // 手ごとの m_Log の開始位置
+    ChangeList m_Changes;               // 直前の Step / Undo / Rewind で変わったセル
+};
+
+} // namespace game
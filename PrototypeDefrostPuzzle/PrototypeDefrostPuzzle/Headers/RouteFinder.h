@@ -1 +1,101 @@
 #pragma once
+
+#include "Field.h"
+#include "Arena.h"
+#include "GameState.h"
+#include "Terrain.h"
+#include <cinttypes>
+#include <vector>
+
+namespace game
+{
+
+// 盤面の最短手順を幅優先探索で求める
+// （20x20 / 4 ピースの盤面はサイズを固定した専用カーネル、それ以外は汎用カーネルで探索する）
+// メインピースがクリアするまでの手数の下限（Terrain::GetClearBounds）が残りの手数を超える状態は、maxMoves 以内に解けないので積まない
+// 探索中の領域はすべて内部の Arena から取り、探索ごとに巻き戻して使い回す
+// 状態はチャンクに積んで広げるときにコピーしないので、一度の探索で使う量は探索の作業領域に近く、次の探索までそのまま持ち続けられる
+// （領域を確保できなかったときは、見つからなかったものとして探索を打ち切る）
+class RouteFinder
+{
+public:
+    enum class Kernel : uint8_t
+    {
+        Auto,       // 盤面サイズとピース数から専用カーネルを選択する
+        Generic,    // 常に汎用カーネルを使う（比較計測用）
+    };
+
+    struct Parameter
+    {
+        int maxMoves;
+        size_t maxStates;
+        Kernel kernel;
+        bool countSolutions;    // 最短手数で解ける手の数を数える
+
+        Parameter()
+            : maxMoves(64)
+            , maxStates(1 << 24)
+            , kernel(Kernel::Auto)
+            , countSolutions(false)
+        {
+
+        }
+    };
+
+    struct Move
+    {
+        int piece;
+        Field::Direction direction;
+
+        Move()
+            : piece(0)
+            , direction(Field::Direction::Up)
+        {}
+        Move(int piece, Field::Direction direction)
+            : piece(piece)
+            , direction(direction)
+        {}
+    };
+
+    struct Result
+    {
+        bool solved;
+        bool specialized;
+        int moveCount;
+        int solutionCount;      // countSolutions 指定時、最後の一手前の状態ごとに数えたクリア手の数
+        size_t visitedStates;
+        size_t arenaBytes;      // この探索で使った Arena の最大量
+        const Move* route;      // moveCount 個の手順、次の Find を呼ぶまで有効
+
+        Result()
+            : solved(false)
+            , specialized(false)
+            , moveCount(0)
+            , solutionCount(0)
+            , visitedStates(0)
+            , arenaBytes(0)
+            , route(nullptr)
+        {}
+    };
+
+public:
+    RouteFinder();
+    ~RouteFinder();
+
+    RouteFinder(const RouteFinder&) = delete;
+    RouteFinder& operator=(const RouteFinder&) = delete;
+
+    // ピースは GameState::MaxPieces 個まで、かつ状態が 64bit に詰められる数まで
+    bool Find(const Field& field, const Parameter& param, Result& result);
+    bool Find(const Field& field, const std::vector<Field::Position>& pieces, const Parameter& param, Result& result);
+    // 遊んでいる途中の状態から解く（停止位置は Terrain のものを使う）
+    bool Find(const Terrain& terrain, const GameState& state, const Parameter& param, Result& result);
+
+    const Arena& GetArena() const { return m_Arena; }
+
+private:
+    Arena m_Arena;
+    Terrain m_Terrain;      // Field から解くときに作る地形
+};
+
+} // namespace game
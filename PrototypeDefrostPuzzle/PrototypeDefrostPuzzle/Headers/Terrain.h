@@ -0,0 +1,75 @@
+#pragma once
+
+#include "CellIndex.h"
+#include "Field.h"
+#include "GameState.h"
+#include "Occupancy.h"
+#include <cinttypes>
+#include <vector>
+
+namespace game
+{
+
+// 盤面のうち遊んでいる間に変わらない部分（地形とゴール）
+// 作った後は書き換えないので、shared_ptr<const Terrain> にして複数の GameState やスレッドから共有できる
+// 停止位置は地形だけで前計算しておき、手を打つときは他のピースとの衝突だけを調べる
+class Terrain
+{
+public:
+    // 空の地形（Reset で作ってから使う）
+    Terrain();
+    explicit Terrain(const Field& field);
+    ~Terrain();
+
+    // 盤面から作り直す（盤面ごとに作り直す探索や生成で、表の領域を使い回すため）
+    void Reset(const Field& field);
+
+    // ピースの位置から初期状態を作る（ピースが多すぎるか、盤面の外にあれば false）
+    bool CreateState(const std::vector<Field::Position>& pieces, GameState& state) const;
+    // ピースを指定方向に滑らせた先のセル（動けなければ今のセル）
+    CellIndex Slide(const GameState& state, int piece, Field::Direction direction) const;
+    // 手を打つ（動けなければ何もせず false を返す）
+    bool Move(GameState& state, int piece, Field::Direction direction) const;
+    // 他のピースとの衝突を occupancy で調べる版（ピースの数によらず、進むセルごとに一度のビット検査で済む）
+    // occupancy は state のピースの位置と一致していること、Move はそれも合わせて更新する
+    CellIndex Slide(const GameState& state, const Occupancy& occupancy, int piece, Field::Direction direction) const;
+    bool Move(GameState& state, Occupancy& occupancy, int piece, Field::Direction direction) const;
+    // メインピースがゴールかそれに隣接したセルにいるか
+    bool IsCleared(const GameState& state) const { return state.pieceNum > 0 && m_Goals[state.pieces[0]]; }
+
+    // ピースのセルは Frozen として返る
+    Field::CellType GetCell(CellIndex cell) const { return m_Cells[cell]; }
+    bool IsWalkable(CellIndex cell) const { return m_Cells[cell] == Field::CellType::Frozen; }
+    bool IsClearCell(CellIndex cell) const { return m_Goals[cell] != 0; }
+    CellIndex GetIndex(const Field::Position& position) const { return MakeCellIndex(position.x, position.y, m_Width); }
+    Field::Position GetPosition(CellIndex cell) const { return Field::Position(GetCellColumn(cell, m_Width), GetCellRow(cell, m_Width)); }
+    CellIndex GetGoalCell() const { return m_Goal; }
+    int32_t GetWidth() const { return m_Width; }
+    int32_t GetHeight() const { return m_Height; }
+
+    // (セル * 4 + 方向) から地形だけを見たときに止まるセル
+    const uint16_t* GetStops() const { return m_Stops.data(); }
+    // メインピースがここで止まればクリア
+    const uint8_t* GetGoals() const { return m_Goals.data(); }
+    // メインピースがここからクリアするまでに少なくとも要る手数（届かなければ UnreachableBound）
+    // 他のピースに当たればどこででも止まれるとみなして数えるので、実際の手数を超えることはない
+    const uint8_t* GetClearBounds() const { return m_ClearBounds.data(); }
+
+    static constexpr uint8_t UnreachableBound = 0xFF;
+
+private:
+    Terrain(const Terrain&) = delete;
+    Terrain& operator=(const Terrain&) = delete;
+
+private:
+    int32_t m_Width;
+    int32_t m_Height;
+    CellIndex m_Goal;
+    std::vector<Field::CellType> m_Cells;
+    std::vector<uint16_t> m_Stops;
+    std::vector<uint8_t> m_Goals;
+    std::vector<uint8_t> m_ClearBounds;
+    std::vector<CellIndex> m_Queue;     // m_ClearBounds を求めるときだけ使う
+};
+
+} // namespace game
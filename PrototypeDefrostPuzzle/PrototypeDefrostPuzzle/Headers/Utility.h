@@ -1,5 +1,7 @@
 #pragma once
-#include <string>
+#include <cinttypes>
+#include <cstddef>
+#include <vector>
 
 namespace game
 {
@@ -7,8 +9,39 @@ namespace game
 class Utility
 {
 public:
-    static const std::string& EncodeRunLength(const std::string& src, std::string& dst);
-    static const std::string& DecodeRunLength(const std::string& src, std::string& dst);
+    // ランレングス（文字と、続く数 - 1 を 36 進一桁で表した文字の組を並べる）
+    // 一組で表せるのは MaxRunLength 文字までで、それより長い並びは組を分ける
+    static constexpr int MaxRunLength = 36;
+    // src の size 文字を符号化して dst に書き、書いた文字数を返す（dst には GetEncodedCapacity(size) 文字分を用意する）
+    static size_t EncodeRunLength(const char* src, size_t size, char* dst);
+    // src の size 文字を戻して dst に書き、書いた文字数を返す（壊れているか capacity に収まらなければ 0）
+    static size_t DecodeRunLength(const char* src, size_t size, char* dst, size_t capacity);
+    static constexpr size_t GetEncodedCapacity(size_t size) { return size * 2; }
+    // 続く数の文字を数に戻す（36 進一桁でなければ -1）
+    static int DecodeRunCount(const char c) { return s_RunCounts.value[static_cast<uint8_t>(c)]; }
+
+    // 値が ByteRunValueNum 未満のバイト列のランレングス（一バイトの上位 3bit に値、下位 5bit に続く数 - 1 を詰める）
+    // 一バイトで表せるのは MaxByteRunLength 個までで、それより長い並びはバイトを分ける
+    static constexpr int ByteRunValueNum = 8;
+    static constexpr int MaxByteRunLength = 32;
+    // src の size バイトを符号化して dst の末尾に書き足す
+    static void EncodeByteRuns(const uint8_t* src, size_t size, std::vector<uint8_t>& dst);
+    // dst のちょうど size バイトが埋まるまで読み、読んだ次の位置を返す（end までに埋まらないか、はみ出せば nullptr）
+    // counts[value] には値ごとに書いた数を足す
+    static const uint8_t* DecodeByteRuns(const uint8_t* src, const uint8_t* end, uint8_t* dst, size_t size, size_t* counts);
+
+    // 可変長整数（下位から 7bit ずつ並べ、続きがあるバイトは最上位ビットを立てる）
+    static void WriteVarint(uint64_t value, std::vector<uint8_t>& dst);
+    // 読んだ次の位置を返す（end までに読み終わらなければ nullptr）
+    static const uint8_t* ReadVarint(const uint8_t* src, const uint8_t* end, uint64_t& value);
+
+private:
+    struct RunCountTable
+    {
+        int8_t value[256];
+    };
+    static constexpr RunCountTable MakeRunCountTable();
+    static const RunCountTable s_RunCounts;
 };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,486 @@
+#include "Benchmark.h"
+
+#include "Field.h"
+#include "MeltSimulation.h"
+#include "PackedField.h"
+#include "RouteFinder.h"
+#include "Terrain.h"
+#include "Utility.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+class Stopwatch
+{
+public:
+    Stopwatch() : m_Start(std::chrono::steady_clock::now()) {}
+
+    double Seconds() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_Start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_Start;
+};
+
+// 手を打ちながら更新してきたハッシュと比べるため、ピースの位置から求め直したものを返す
+game::GameState RehashedCopy(game::GameState state)
+{
+    state.Rehash();
+    return state;
+}
+
+}
+
+namespace prototype
+{
+
+int Benchmark::SolverKernel(int argc, char** argv)
+{
+    const int boardNum = argc > 0 ? std::atoi(argv[0]) : 200;
+
+    std::vector<game::Field> fields(boardNum);
+    // シードを固定して、毎回同じ盤面で計測する
+    game::Field::CreateParameter param;
+    param.seed = 0;
+    std::vector<game::Field::Position> pieces;
+    for (auto& field : fields)
+    {
+        bool created = false;
+        while (!created)
+        {
+            created = field.Create(param) && field.PutPieces(pieces, 4);
+            ++param.index;
+        }
+    }
+
+    game::RouteFinder finder;
+    game::RouteFinder::Parameter findParam;
+    game::RouteFinder::Result result;
+
+    // 専用カーネルと汎用カーネルで同じ盤面を解き、結果が一致することも確認する
+    std::vector<int> moves(boardNum);
+    size_t states = 0;
+    int solved = 0;
+
+    findParam.kernel = game::RouteFinder::Kernel::Generic;
+    Stopwatch genericWatch;
+    for (int index = 0; index < boardNum; ++index)
+    {
+        finder.Find(fields[index], findParam, result);
+        moves[index] = result.solved ? result.moveCount : -1;
+        states += result.visitedStates;
+    }
+    const double genericTime = genericWatch.Seconds();
+
+    findParam.kernel = game::RouteFinder::Kernel::Auto;
+    int mismatch = 0;
+    size_t arenaTotal = 0, arenaMax = 0;
+    const size_t blockAllocations = finder.GetArena().GetBlockAllocationCount();
+    Stopwatch specializedWatch;
+    for (int index = 0; index < boardNum; ++index)
+    {
+        finder.Find(fields[index], findParam, result);
+        if ((result.solved ? result.moveCount : -1) != moves[index])
+        {
+            ++mismatch;
+        }
+        solved += result.solved ? 1 : 0;
+        arenaTotal += result.arenaBytes;
+        arenaMax = std::max(arenaMax, result.arenaBytes);
+    }
+    const double specializedTime = specializedWatch.Seconds();
+
+    // Terrain と GameState から解き直し、求めた手順を打ち直してクリアできることを確かめる
+    // 同じ手順を Occupancy を使う版でも打ち、止まる位置が変わらないことも確かめる
+    // 通ったセルを溶かしていき、最後に一手ずつ戻して元の地形に戻ることも確かめる
+    // 外周以外のブロックは HardFrozen に置き換えて打つ（どちらも通れないので手数は変わらず、ぶつかったものは Cracked になる）
+    int replayMismatch = 0, hardMelted = 0;
+    game::Occupancy occupancy;
+    game::MeltSimulation melt;
+    for (int index = 0; index < boardNum; ++index)
+    {
+        game::Field hardened = fields[index];
+        hardened.ForEachCell([&](const int x, const int y, const game::Field::CellType cell)
+        {
+            if (cell == game::Field::CellType::Block && x > 0 && y > 0 && x < hardened.GetWidth() - 1 && y < hardened.GetHeight() - 1)
+            {
+                hardened.SetCell(x, y, game::Field::CellType::HardFrozen);
+            }
+        });
+        const game::Terrain terrain(hardened);
+        game::GameState state;
+        terrain.CreateState(hardened.GetPieces(), state);
+        finder.Find(terrain, state, findParam, result);
+        if ((result.solved ? result.moveCount : -1) != moves[index])
+        {
+            ++replayMismatch;
+            continue;
+        }
+        game::GameState occupied = state;
+        occupancy.Reset(terrain.GetWidth() * terrain.GetHeight());
+        occupancy.Assign(occupied);
+        melt.Reset(terrain);
+        const int offsets[] = { -terrain.GetWidth(), -1, 1, terrain.GetWidth() };
+        for (int move = 0; move < result.moveCount; ++move)
+        {
+            const game::CellIndex from = state.pieces[result.route[move].piece];
+            terrain.Move(state, result.route[move].piece, result.route[move].direction);
+            terrain.Move(occupied, occupancy, result.route[move].piece, result.route[move].direction);
+            const game::CellIndex to = state.pieces[result.route[move].piece];
+            // HardFrozen が変わるのは、滑ったピースがぶつかったセルだけ
+            for (const auto& change : melt.Step(from, to))
+            {
+                if (change.before == game::Field::CellType::HardFrozen)
+                {
+                    ++hardMelted;
+                    replayMismatch += (from == to || change.after != game::Field::CellType::Cracked
+                        || change.cell != to + offsets[static_cast<int>(result.route[move].direction)]) ? 1 : 0;
+                }
+            }
+        }
+        while (melt.GetStepNum() > 0)
+        {
+            melt.Undo();
+        }
+        for (int cell = 0, cellNum = terrain.GetWidth() * terrain.GetHeight(); cell < cellNum; ++cell)
+        {
+            if (melt.GetCell(static_cast<game::CellIndex>(cell)) != terrain.GetCell(static_cast<game::CellIndex>(cell)))
+            {
+                ++replayMismatch;
+                break;
+            }
+        }
+        if (result.solved && (!terrain.IsCleared(state) || state.moveCount != result.moveCount
+            || !std::equal(state.pieces, state.pieces + state.pieceNum, occupied.pieces)
+            || state.hash != occupied.hash || state.hash != RehashedCopy(state).hash))
+        {
+            ++replayMismatch;
+        }
+    }
+
+    std::cout << "boards      : " << boardNum << " (solved " << solved << ", mismatch " << mismatch << ", replay mismatch " << replayMismatch << ")" << std::endl;
+    std::cout << "melt        : " << hardMelted << " hard frozen cells cracked by stopping pieces" << std::endl;
+    std::cout << "states      : " << states << std::endl;
+    std::cout << "generic     : " << genericTime << " s, " << states / genericTime << " states/s" << std::endl;
+    std::cout << "specialized : " << specializedTime << " s, " << states / specializedTime << " states/s" << std::endl;
+    std::cout << "speedup     : " << genericTime / specializedTime << "x" << std::endl;
+    std::cout << "arena       : avg " << arenaTotal / boardNum << " bytes, max " << arenaMax << " bytes, reserved "
+        << finder.GetArena().GetReservedBytes() << " bytes, heap blocks " << finder.GetArena().GetBlockAllocationCount() - blockAllocations
+        << " (second pass)" << std::endl;
+
+    return mismatch == 0 && replayMismatch == 0 && hardMelted > 0 ? 0 : 1;
+}
+
+int Benchmark::FieldStorage(int argc, char** argv)
+{
+    const int fieldNum = argc > 0 ? std::atoi(argv[0]) : 100000;
+    if (fieldNum <= 0)
+    {
+        return 1;
+    }
+
+    // 生成器と同じく、盤面を作っては捨てる（シードは固定する）
+    game::Field::CreateParameter param;
+    param.seed = 0;
+    std::vector<game::Field::Position> pieces;
+    int created = 0;
+    Stopwatch createWatch;
+    for (int index = 0; index < fieldNum; ++index)
+    {
+        game::Field field;
+        param.index = index;
+        if (field.Create(param) && field.PutPieces(pieces, 4))
+        {
+            ++created;
+        }
+    }
+    const double createTime = createWatch.Seconds();
+
+    // 盤面の中身だけを作り直す（確保と解放が大半を占める）
+    game::Field source;
+    param.index = 0;
+    while (!source.Create(param) || !source.PutPieces(pieces, 4))
+    {
+        ++param.index;
+    }
+    std::vector<game::Field::CellType> cells(source.GetWidth() * source.GetHeight());
+    for (int y = 0; y < source.GetHeight(); ++y)
+    {
+        for (int x = 0; x < source.GetWidth(); ++x)
+        {
+            cells[y * source.GetWidth() + x] = source.GetCell(x, y);
+        }
+    }
+    Stopwatch rebuildWatch;
+    for (int index = 0; index < fieldNum; ++index)
+    {
+        game::Field field;
+        field.CreateFromCells(source.GetWidth(), source.GetHeight(), cells.data(), pieces);
+    }
+    const double rebuildTime = rebuildWatch.Seconds();
+
+    // 全セルを読む（一セルずつと、行ごと）
+    size_t checksum = 0;
+    Stopwatch scanWatch;
+    for (int index = 0; index < fieldNum; ++index)
+    {
+        for (int y = 0; y < source.GetHeight(); ++y)
+        {
+            for (int x = 0; x < source.GetWidth(); ++x)
+            {
+                checksum += static_cast<size_t>(source.GetCell(x, y));
+            }
+        }
+    }
+    const double scanTime = scanWatch.Seconds();
+
+    size_t rowChecksum = 0;
+    Stopwatch rowWatch;
+    for (int index = 0; index < fieldNum; ++index)
+    {
+        for (int y = 0; y < source.GetHeight(); ++y)
+        {
+            for (const auto cell : source.GetRow(y))
+            {
+                rowChecksum += static_cast<size_t>(cell);
+            }
+        }
+    }
+    const double rowTime = rowWatch.Seconds();
+
+    // 複製してから一部だけ書き換える（書き換えた分だけセルが複製される）
+    std::vector<game::Field> clones;
+    clones.reserve(fieldNum);
+    Stopwatch cloneWatch;
+    for (int index = 0; index < fieldNum; ++index)
+    {
+        clones.push_back(source);
+    }
+    const double cloneTime = cloneWatch.Seconds();
+    Stopwatch writeWatch;
+    for (int index = 0; index < fieldNum; index += 10)
+    {
+        clones[index].SetCell(1, 1, game::Field::CellType::Melted);
+    }
+    const double writeTime = writeWatch.Seconds();
+    double sharedBytes = 0.0;
+    for (const auto& clone : clones)
+    {
+        sharedBytes += static_cast<double>(clone.GetCells().GetSize()) / clone.GetCellsUseCount();
+    }
+    clones.clear();
+
+    // 一セルずつ書き換えながらハッシュを取る（差分で更新した値と、全セルから求め直した値）
+    // 同じ書き換えを二度行い、両方の値の並びが一致することも確かめる
+    auto hashEdits = [&](const bool recompute, uint64_t& hashChecksum)
+    {
+        game::Field edited = source;
+        game::Random editRandom(1);
+        hashChecksum = 0;
+        Stopwatch hashWatch;
+        for (int index = 0; index < fieldNum; ++index)
+        {
+            const int x = 1 + static_cast<int>(editRandom.Below(static_cast<uint32_t>(edited.GetWidth() - 2)));
+            const int y = 1 + static_cast<int>(editRandom.Below(static_cast<uint32_t>(edited.GetHeight() - 2)));
+            const auto cell = edited.GetCell(x, y);
+            if (cell == game::Field::CellType::Frozen || cell == game::Field::CellType::Block)
+            {
+                edited.SetCell(x, y, cell == game::Field::CellType::Frozen ? game::Field::CellType::Block : game::Field::CellType::Frozen);
+            }
+            hashChecksum = hashChecksum * 31 + (recompute ? edited.ComputeHash() : edited.GetHash());
+        }
+        return hashWatch.Seconds();
+    };
+    uint64_t incrementalChecksum = 0, recomputedChecksum = 0;
+    const double incrementalTime = hashEdits(false, incrementalChecksum);
+    const double recomputeTime = hashEdits(true, recomputedChecksum);
+
+    // 文字列形式とバイナリ形式で書いて読む（読むほうは同じ Field を使い回す）
+    std::string text;
+    Stopwatch textWriteWatch;
+    for (int index = 0; index < fieldNum; ++index)
+    {
+        source.Serialize(text);
+    }
+    const double textWriteTime = textWriteWatch.Seconds();
+    game::Field textField;
+    int textRejected = 0;
+    Stopwatch textReadWatch;
+    for (int index = 0; index < fieldNum; ++index)
+    {
+        textRejected += textField.CreateFromText(text.data(), text.size()) != game::Field::ParseError::None;
+    }
+    const double textReadTime = textReadWatch.Seconds();
+    std::string textText;
+    textField.Serialize(textText);
+    // 途中で切れたものは受け付けない
+    const bool textTruncatedRejected = game::Field().CreateFromText(text.data(), text.size() - 1) != game::Field::ParseError::None;
+    const bool textMatch = textRejected == 0 && textText == text && textField.GetHash() == source.GetHash() && textTruncatedRejected;
+
+    // ランレングスだけを取り出して戻す・詰めるを繰り返す（呼び出し側の領域を使い回す）
+    const std::string encoded = text.substr(text.find(',', text.find(',') + 1) + 1);
+    const size_t cellNum = static_cast<size_t>(source.GetWidth() * source.GetHeight());
+    std::vector<char> decoded(cellNum), reencoded(game::Utility::GetEncodedCapacity(cellNum));
+    size_t decodedSize = 0, reencodedSize = 0;
+    Stopwatch rleDecodeWatch;
+    for (int index = 0; index < fieldNum; ++index)
+    {
+        decodedSize = game::Utility::DecodeRunLength(encoded.data(), encoded.size(), decoded.data(), decoded.size());
+    }
+    const double rleDecodeTime = rleDecodeWatch.Seconds();
+    Stopwatch rleEncodeWatch;
+    for (int index = 0; index < fieldNum; ++index)
+    {
+        reencodedSize = game::Utility::EncodeRunLength(decoded.data(), decodedSize, reencoded.data());
+    }
+    const double rleEncodeTime = rleEncodeWatch.Seconds();
+    bool rleMatch = decodedSize == cellNum && std::string(reencoded.data(), reencodedSize) == encoded;
+    // 一組に収まる 36 文字の前後で、組の分け方と戻した結果を確かめる
+    for (int run = 1; run <= game::Utility::MaxRunLength * 3 + 1; ++run)
+    {
+        const std::string plain = "1" + std::string(run, '0') + "2";
+        std::vector<char> packed(game::Utility::GetEncodedCapacity(plain.size())), unpacked(plain.size());
+        const size_t packedSize = game::Utility::EncodeRunLength(plain.data(), plain.size(), packed.data());
+        const size_t pairNum = (run + game::Utility::MaxRunLength - 1) / game::Utility::MaxRunLength + 2;
+        const size_t unpackedSize = game::Utility::DecodeRunLength(packed.data(), packedSize, unpacked.data(), unpacked.size());
+        rleMatch = rleMatch && packedSize == pairNum * 2 && std::string(unpacked.data(), unpackedSize) == plain;
+    }
+
+    std::vector<uint8_t> binary;
+    Stopwatch binaryWriteWatch;
+    for (int index = 0; index < fieldNum; ++index)
+    {
+        binary.clear();
+        source.SerializeBinary(binary);
+    }
+    const double binaryWriteTime = binaryWriteWatch.Seconds();
+    game::Field binaryField;
+    size_t binaryRead = 0;
+    Stopwatch binaryReadWatch;
+    for (int index = 0; index < fieldNum; ++index)
+    {
+        binaryRead += binaryField.CreateFromBinary(binary.data(), binary.size());
+    }
+    const double binaryReadTime = binaryReadWatch.Seconds();
+    std::string binaryText;
+    binaryField.Serialize(binaryText);
+    // 末尾のピースの位置を書き換え、ピースが重なったものと、ゴールに乗ったものは受け付けない
+    std::vector<uint64_t> pieceCells;
+    std::vector<uint8_t> pieceBytes;
+    for (const auto& piece : source.GetPieces())
+    {
+        pieceCells.push_back(static_cast<uint64_t>(piece.y * source.GetWidth() + piece.x));
+        game::Utility::WriteVarint(pieceCells.back(), pieceBytes);
+    }
+    const game::Field::Position goal = source.GetGoalPosition();
+    const uint64_t corruptCells[] = { pieceCells[0], static_cast<uint64_t>(goal.y * source.GetWidth() + goal.x) };
+    bool binaryCorruptRejected = true;
+    for (const uint64_t corruptCell : corruptCells)
+    {
+        std::vector<uint8_t> corrupt(binary.begin(), binary.end() - pieceBytes.size());
+        for (size_t piece = 0; piece < pieceCells.size(); ++piece)
+        {
+            game::Utility::WriteVarint(piece == 1 ? corruptCell : pieceCells[piece], corrupt);
+        }
+        binaryCorruptRejected = binaryCorruptRejected && game::Field().CreateFromBinary(corrupt.data(), corrupt.size()) == 0;
+    }
+    // ゴールを Frozen にしたものと、Frozen のセルをもう一つゴールにしたものも受け付けない
+    const game::Field::ConstRow sourceCells = source.GetCells();
+    const int goalCell = goal.y * source.GetWidth() + goal.x;
+    const int frozenCell = static_cast<int>(std::find(sourceCells.begin(), sourceCells.end(), game::Field::CellType::Frozen) - sourceCells.begin());
+    for (const int goalNum : { 0, 2 })
+    {
+        std::vector<game::Field::CellType> cells(sourceCells.begin(), sourceCells.end());
+        cells[goalNum == 0 ? goalCell : frozenCell] = goalNum == 0 ? game::Field::CellType::Frozen : game::Field::CellType::Goal;
+        game::Field variant;
+        std::vector<uint8_t> corrupt;
+        binaryCorruptRejected = binaryCorruptRejected && frozenCell < sourceCells.GetSize()
+            && variant.CreateFromCells(source.GetWidth(), source.GetHeight(), cells.data(), source.GetPieces());
+        variant.SerializeBinary(corrupt);
+        binaryCorruptRejected = binaryCorruptRejected && game::Field().CreateFromBinary(corrupt.data(), corrupt.size()) == 0;
+    }
+    std::cerr << "DBG " << (binaryRead == binary.size() * fieldNum) << (binaryText == text) << (binaryField.GetHash() == source.GetHash()) << binaryCorruptRejected << std::endl;
+    const bool binaryMatch = binaryRead == binary.size() * fieldNum && binaryText == text && binaryField.GetHash() == source.GetHash()
+        && binaryCorruptRejected;
+
+    // 詰めて持ったときの大きさと、詰める・戻す・行を戻す速さ
+    const game::PackedField::Encoding encodings[] = { game::PackedField::Encoding::Cell4, game::PackedField::Encoding::Terrain2 };
+    double packTimes[2], unpackTimes[2], decodeTimes[2];
+    size_t packedBytes[2], packedChecksums[2];
+    int mismatch = 0;
+    for (int encoding = 0; encoding < 2; ++encoding)
+    {
+        std::vector<game::PackedField> packed(fieldNum);
+        Stopwatch packWatch;
+        for (auto& field : packed)
+        {
+            field.Pack(source, encodings[encoding]);
+        }
+        packTimes[encoding] = packWatch.Seconds();
+        packedBytes[encoding] = sizeof(game::PackedField) + packed.front().GetDataSize();
+
+        std::vector<game::Field::CellType> row(source.GetWidth());
+        size_t decoded = 0;
+        Stopwatch decodeWatch;
+        for (const auto& field : packed)
+        {
+            for (int y = 0; y < field.GetHeight(); ++y)
+            {
+                field.DecodeRow(y, row.data());
+                decoded += static_cast<size_t>(row[y % row.size()]);
+            }
+        }
+        decodeTimes[encoding] = decodeWatch.Seconds();
+        packedChecksums[encoding] = decoded;
+
+        game::Field unpacked;
+        Stopwatch unpackWatch;
+        for (const auto& field : packed)
+        {
+            field.Unpack(unpacked);
+        }
+        unpackTimes[encoding] = unpackWatch.Seconds();
+
+        std::string expected, actual;
+        source.Serialize(expected);
+        unpacked.Serialize(actual);
+        mismatch += expected == actual ? 0 : 1;
+    }
+    const size_t fieldBytes = sizeof(game::Field) + source.GetWidth() * source.GetHeight() + source.GetPieces().size() * sizeof(game::Field::Position);
+
+    std::cout << "fields      : " << fieldNum << " (created " << created << ", checksum " << checksum << "/" << rowChecksum << ")" << std::endl;
+    std::cout << "create      : " << createTime << " s, " << createTime * 1e9 / fieldNum << " ns/field" << std::endl;
+    std::cout << "from cells  : " << rebuildTime << " s, " << rebuildTime * 1e9 / fieldNum << " ns/field" << std::endl;
+    std::cout << "scan cells  : " << scanTime << " s, " << scanTime * 1e9 / fieldNum << " ns/field" << std::endl;
+    std::cout << "scan rows   : " << rowTime << " s, " << rowTime * 1e9 / fieldNum << " ns/field" << std::endl;
+    std::cout << "clone       : " << cloneTime * 1e9 / fieldNum << " ns/field, first write " << writeTime * 1e9 / ((fieldNum + 9) / 10)
+        << " ns/field, cells " << sharedBytes / fieldNum << " bytes/field (1 in 10 written)" << std::endl;
+    const char* names[] = { "cell4", "terrain2" };
+    std::cout << "hash        : incremental " << incrementalTime * 1e9 / fieldNum << " ns/edit, recompute " << recomputeTime * 1e9 / fieldNum
+        << " ns/edit (" << (incrementalChecksum == recomputedChecksum ? "match" : "MISMATCH") << ")" << std::endl;
+    std::cout << "text        : " << text.size() << " bytes/field, write " << textWriteTime * 1e9 / fieldNum << " ns, read "
+        << textReadTime * 1e9 / fieldNum << " ns (" << (textMatch ? "match" : "MISMATCH") << ")" << std::endl;
+    std::cout << "rle         : " << encoded.size() << " -> " << decodedSize << " chars, decode " << rleDecodeTime * 1e9 / fieldNum
+        << " ns, encode " << rleEncodeTime * 1e9 / fieldNum << " ns (" << (rleMatch ? "match" : "MISMATCH") << ")" << std::endl;
+    std::cout << "binary      : " << binary.size() << " bytes/field, write " << binaryWriteTime * 1e9 / fieldNum << " ns, read "
+        << binaryReadTime * 1e9 / fieldNum << " ns (" << (binaryMatch ? "match" : "MISMATCH") << ")" << std::endl;
+    std::cout << "field       : " << fieldBytes << " bytes/field" << std::endl;
+    for (int encoding = 0; encoding < 2; ++encoding)
+    {
+        std::cout << names[encoding] << (encoding == 0 ? "       : " : "    : ") << packedBytes[encoding] << " bytes/field, pack "
+            << packTimes[encoding] * 1e9 / fieldNum << " ns, decode rows " << decodeTimes[encoding] * 1e9 / fieldNum << " ns, unpack "
+            << unpackTimes[encoding] * 1e9 / fieldNum << " ns (checksum " << packedChecksums[encoding] << ")" << std::endl;
+    }
+
+    return mismatch == 0 && incrementalChecksum == recomputedChecksum && textMatch && rleMatch && binaryMatch ? 0 : 1;
+}
+
+} // namespace prototype
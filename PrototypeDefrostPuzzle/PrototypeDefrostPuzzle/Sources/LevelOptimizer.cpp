@@ -0,0 +1,138 @@
+#include "LevelOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace game
+{
+
+LevelOptimizer::LevelOptimizer()
+    : m_Random()
+    , m_Finder()
+    , m_Rocks()
+    , m_Best()
+{
+
+}
+
+LevelOptimizer::~LevelOptimizer()
+{
+
+}
+
+bool LevelOptimizer::Optimize(const Parameter& param, Field& field, Result& result)
+{
+    result = Result();
+
+    const int width = field.GetWidth(), height = field.GetHeight();
+    const int cellCount = width * height;
+
+    m_Rocks.clear();
+    field.ForEachCell([&](const int x, const int y, const Field::CellType cell)
+    {
+        const int index = y * width + x;
+        if (cell == Field::CellType::Block && IsMovable(index, width, height))
+        {
+            m_Rocks.push_back(index);
+        }
+    });
+
+    Score current;
+    if (m_Rocks.empty() || !Solve(param, field, param.maxMoves, current))
+    {
+        return false;
+    }
+
+    Score best = current;
+    m_Best.resize(cellCount);
+    for (int index = 0; index < cellCount; ++index)
+    {
+        m_Best[index] = field.GetCell(index % width, index / width);
+    }
+    result.initialMoves = current.moveCount;
+
+    m_Random = Random(param.seed);
+
+    for (int iteration = 0; iteration < param.iterations; ++iteration)
+    {
+        // ブロックを一つ選び、近くの空いているセルへ移す
+        const size_t rock = m_Random.Below(static_cast<uint32_t>(m_Rocks.size()));
+        const int from = m_Rocks[rock];
+        const int toX = from % width + m_Random.Range(-param.moveRange, param.moveRange);
+        const int toY = from / width + m_Random.Range(-param.moveRange, param.moveRange);
+        if (toX < 0 || toY < 0 || toX >= width || toY >= height)
+        {
+            continue;
+        }
+        const int to = toY * width + toX;
+        if (!IsMovable(to, width, height) || field.GetCell(toX, toY) != Field::CellType::Frozen)
+        {
+            continue;
+        }
+
+        ++result.mutations;
+        field.SetCell(from % width, from / width, Field::CellType::Frozen);
+        field.SetCell(toX, toY, Field::CellType::Block);
+
+        Score next;
+        Solve(param, field, std::min(current.moveCount + param.moveMargin, param.maxMoves), next);
+
+        const double temperature = param.startTemperature
+            + (param.endTemperature - param.startTemperature) * iteration / param.iterations;
+        const double delta = next.Value() - current.Value();
+        const bool accept = next.solved
+            && (delta >= 0.0 || m_Random.NextDouble() < std::exp(delta / temperature));
+
+        if (!accept)
+        {
+            field.SetCell(toX, toY, Field::CellType::Frozen);
+            field.SetCell(from % width, from / width, Field::CellType::Block);
+            continue;
+        }
+
+        ++result.accepted;
+        m_Rocks[rock] = to;
+        current = next;
+
+        if (current.Value() > best.Value())
+        {
+            best = current;
+            for (int index = 0; index < cellCount; ++index)
+            {
+                m_Best[index] = field.GetCell(index % width, index / width);
+            }
+        }
+    }
+
+    for (int index = 0; index < cellCount; ++index)
+    {
+        field.SetCell(index % width, index / width, m_Best[index]);
+    }
+
+    result.moveCount = best.moveCount;
+    result.solutionCount = best.solutionCount;
+    return true;
+}
+
+bool LevelOptimizer::Solve(const Parameter& param, const Field& field, const int maxMoves, Score& score)
+{
+    RouteFinder::Parameter findParam;
+    findParam.maxMoves = maxMoves;
+    findParam.maxStates = param.maxStates;
+    findParam.countSolutions = true;
+
+    RouteFinder::Result found;
+    score = Score();
+    score.solved = m_Finder.Find(field, findParam, found);
+    score.moveCount = found.moveCount;
+    score.solutionCount = found.solutionCount;
+    return score.solved;
+}
+
+bool LevelOptimizer::IsMovable(const int cell, const int width, const int height) const
+{
+    const int x = cell % width, y = cell / width;
+    return x > 0 && y > 0 && x < width - 1 && y < height - 1;
+}
+
+} // namespace game
@@ -0,0 +1,767 @@
+#include "LevelPipeline.h"
+
+#include "Field.h"
+#include "LevelGenerator.h"
+#include "LevelOptimizer.h"
+#include "LevelPack.h"
+#include "MappedFile.h"
+#include "NearDuplicateFinder.h"
+#include "PlayoutEstimator.h"
+#include "ReverseGenerator.h"
+#include "RouteFinder.h"
+#include "Symmetry.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+constexpr int StageNum = static_cast<int>(game::LevelGenerator::Stage::Num);
+// 続けてこれだけ作れなければあきらめる（作れない設定で回り続けないため）
+constexpr int MaxFailuresInRow = 64;
+
+const char* StageName(const int stage)
+{
+    const char* names[StageNum] = { "generate", "screen", "solve", "accept" };
+    return names[stage];
+}
+
+// 段階ごとの通過数と処理時間（スレッドごとに集計して最後に合算する）
+struct StageCounter
+{
+    std::atomic<uint64_t> count[StageNum];
+    std::atomic<uint64_t> nanoseconds[StageNum];
+
+    StageCounter()
+    {
+        for (int stage = 0; stage < StageNum; ++stage)
+        {
+            count[stage] = 0;
+            nanoseconds[stage] = 0;
+        }
+    }
+
+    void Add(const int stage, const Clock::duration elapsed)
+    {
+        count[stage].fetch_add(1, std::memory_order_relaxed);
+        nanoseconds[stage].fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), std::memory_order_relaxed);
+    }
+};
+
+// 一行の先頭（タブの手前まで）の盤面コードを読む（行を切り出して複製はしない）
+bool ParseLevelLine(const std::string& line, game::Field& field)
+{
+    const size_t length = std::min(line.find('\t'), line.size());
+    return field.CreateFromText(line.data(), length) == game::Field::ParseError::None;
+}
+
+// シードの指定がなければ実行ごとに変える（出力した番号と合わせて盤面を作り直せるよう表示しておく）
+uint64_t ParseSeed(const int argc, char** argv, const int position)
+{
+    const uint64_t seed = argc > position ? std::strtoull(argv[position], nullptr, 10) : std::random_device{}();
+    std::cerr << "seed " << seed << std::endl;
+    return seed;
+}
+
+void PrintStages(const StageCounter& counter, const double seconds)
+{
+    for (int stage = 0; stage < StageNum; ++stage)
+    {
+        const uint64_t count = counter.count[stage].load();
+        const double busy = counter.nanoseconds[stage].load() * 1e-9;
+        std::cerr << "  " << StageName(stage) << "\t" << count << " boards\t"
+            << count / seconds << " boards/s";
+        if (busy > 0)
+        {
+            std::cerr << "\t(" << count / busy << " boards/s per thread)";
+        }
+        std::cerr << std::endl;
+    }
+}
+
+}
+
+namespace prototype
+{
+
+int LevelPipeline::Run(int argc, char** argv)
+{
+    const char* const usage = "usage: generate <count> <minMoves> <maxMoves> [threads] [output] [seed]";
+    if (argc < 3)
+    {
+        std::cerr << usage << std::endl;
+        return 1;
+    }
+
+    const int levelNum = std::atoi(argv[0]);
+    game::LevelGenerator::Parameter param;
+    param.minMoves = std::atoi(argv[1]);
+    param.maxMoves = std::atoi(argv[2]);
+    const unsigned hardware = std::thread::hardware_concurrency();
+    const int threadNum = argc > 3 ? std::atoi(argv[3]) : static_cast<int>(hardware > 0 ? hardware : 1);
+    // 働くスレッドがないと受理数が増えないまま待ち続けるので、始める前に弾く
+    if (levelNum <= 0 || threadNum <= 0 || param.minMoves > param.maxMoves)
+    {
+        std::cerr << usage << std::endl;
+        return 1;
+    }
+
+    std::ofstream file;
+    if (argc > 4)
+    {
+        file.open(argv[4]);
+        if (!file)
+        {
+            std::cerr << "cannot open " << argv[4] << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& output = file.is_open() ? file : std::cout;
+    param.field.seed = ParseSeed(argc, argv, 5);
+
+    StageCounter counter;
+    std::atomic<int> accepted(0);
+    std::mutex outputMutex;
+    const auto start = Clock::now();
+
+    // 盤面の番号はスレッドごとに飛び飛びに割り当てるので、スレッド間で調整せずに重複しない
+    auto worker = [&](const int threadIndex)
+    {
+        game::LevelGenerator generator;
+        game::LevelGenerator::Parameter threadParam = param;
+        game::Field field;
+        game::LevelGenerator::Result result;
+        std::string code;
+
+        for (uint64_t index = threadIndex; accepted.load(std::memory_order_relaxed) < levelNum; index += threadNum)
+        {
+            threadParam.field.index = index;
+
+            auto begin = Clock::now();
+            const bool created = generator.CreateCandidate(threadParam, field);
+            auto end = Clock::now();
+            counter.Add(static_cast<int>(game::LevelGenerator::Stage::Generate), end - begin);
+            if (!created)
+            {
+                continue;
+            }
+
+            begin = end;
+            const bool screened = generator.Screen(threadParam, field);
+            end = Clock::now();
+            counter.Add(static_cast<int>(game::LevelGenerator::Stage::Screen), end - begin);
+            if (!screened)
+            {
+                continue;
+            }
+
+            begin = end;
+            const bool solved = generator.Solve(threadParam, field, result);
+            end = Clock::now();
+            counter.Add(static_cast<int>(game::LevelGenerator::Stage::Solve), end - begin);
+            if (!solved)
+            {
+                continue;
+            }
+
+            if (accepted.fetch_add(1) >= levelNum)
+            {
+                break;
+            }
+            counter.Add(static_cast<int>(game::LevelGenerator::Stage::Accept), Clock::duration::zero());
+
+            field.Serialize(code);
+            std::lock_guard<std::mutex> lock(outputMutex);
+            output << code << "\t" << result.moveCount << "\t" << index << "\n";
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int index = 0; index < threadNum; ++index)
+    {
+        threads.emplace_back(worker, index);
+    }
+
+    // 終わるまで定期的に進捗を出す
+    auto lastReport = Clock::now();
+    while (accepted.load() < levelNum)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (Clock::now() - lastReport >= std::chrono::seconds(5))
+        {
+            lastReport = Clock::now();
+            const double seconds = std::chrono::duration<double>(lastReport - start).count();
+            std::cerr << "[" << seconds << " s] " << std::min(accepted.load(), levelNum) << "/" << levelNum << std::endl;
+            PrintStages(counter, seconds);
+        }
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    output.flush();
+
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cerr << "levels " << levelNum << " in " << seconds << " s with " << threadNum << " threads ("
+        << levelNum / seconds * 3600.0 << " levels/hour)" << std::endl;
+    PrintStages(counter, seconds);
+
+    return 0;
+}
+
+int LevelPipeline::RunReverse(int argc, char** argv)
+{
+    const char* const usage = "usage: reverse <count> [maxDepth] [output] [seed]";
+    if (argc < 1)
+    {
+        std::cerr << usage << std::endl;
+        return 1;
+    }
+
+    const int levelNum = std::atoi(argv[0]);
+    game::ReverseGenerator::Parameter param;
+    if (argc > 1)
+    {
+        param.maxDepth = std::atoi(argv[1]);
+    }
+    if (levelNum <= 0 || param.maxDepth <= 0)
+    {
+        std::cerr << usage << std::endl;
+        return 1;
+    }
+
+    std::ofstream file;
+    if (argc > 2)
+    {
+        file.open(argv[2]);
+        if (!file)
+        {
+            std::cerr << "cannot open " << argv[2] << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& output = file.is_open() ? file : std::cout;
+    param.field.seed = ParseSeed(argc, argv, 3);
+
+    game::ReverseGenerator generator;
+    game::ReverseGenerator::Result result;
+    game::Field field;
+    std::string code;
+
+    int generated = 0, attempts = 0, failures = 0;
+    long long totalMoves = 0;
+    int maxMoves = 0;
+    const auto start = Clock::now();
+    while (generated < levelNum)
+    {
+        param.field.index = attempts++;
+        if (!generator.Generate(param, field, result))
+        {
+            if (++failures >= MaxFailuresInRow)
+            {
+                std::cerr << "gave up after " << failures << " failed attempts in a row" << std::endl;
+                return 1;
+            }
+            continue;
+        }
+
+        failures = 0;
+        ++generated;
+        totalMoves += result.moveCount;
+        maxMoves = std::max(maxMoves, result.moveCount);
+
+        field.Serialize(code);
+        output << code << "\t" << result.moveCount << "\t" << result.visitedStates << "\t" << param.field.index << "\n";
+    }
+    output.flush();
+
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cerr << "levels " << generated << " (" << attempts << " attempts) in " << seconds << " s, "
+        << generated / seconds << " levels/s, moves avg " << static_cast<double>(totalMoves) / generated
+        << " max " << maxMoves << std::endl;
+
+    return 0;
+}
+
+int LevelPipeline::RunOptimize(int argc, char** argv)
+{
+    const char* const usage = "usage: optimize <count> [iterations] [output] [seed]";
+    if (argc < 1)
+    {
+        std::cerr << usage << std::endl;
+        return 1;
+    }
+
+    const int levelNum = std::atoi(argv[0]);
+    game::LevelOptimizer::Parameter param;
+    if (argc > 1)
+    {
+        param.iterations = std::atoi(argv[1]);
+    }
+    if (levelNum <= 0 || param.iterations < 0)
+    {
+        std::cerr << usage << std::endl;
+        return 1;
+    }
+
+    std::ofstream file;
+    if (argc > 2)
+    {
+        file.open(argv[2]);
+        if (!file)
+        {
+            std::cerr << "cannot open " << argv[2] << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& output = file.is_open() ? file : std::cout;
+    const uint64_t seed = ParseSeed(argc, argv, 3);
+
+    // 元の盤面は通常の生成器で作る（解けるものなら手数は問わない）
+    game::LevelGenerator generator;
+    game::LevelGenerator::Parameter generateParam;
+    game::LevelGenerator::Result generated;
+    generateParam.field.seed = seed;
+    game::LevelOptimizer optimizer;
+    game::LevelOptimizer::Result result;
+    game::Field field;
+    std::string code;
+
+    long long mutations = 0;
+    long long initialMoves = 0, totalMoves = 0;
+    int maxMoves = 0, deepLevels = 0, failures = 0;
+    double optimizeSeconds = 0.0;
+
+    for (int level = 0; level < levelNum; ++level)
+    {
+        while (!generator.Generate(generateParam, field, generated))
+        {
+            ++generateParam.field.index;
+        }
+        const uint64_t index = generateParam.field.index++;
+        param.seed = game::Random::Mix(seed + index);
+
+        const auto begin = Clock::now();
+        if (!optimizer.Optimize(param, field, result))
+        {
+            if (++failures >= MaxFailuresInRow)
+            {
+                std::cerr << "gave up after " << failures << " failed attempts in a row" << std::endl;
+                return 1;
+            }
+            --level;
+            continue;
+        }
+        failures = 0;
+        optimizeSeconds += std::chrono::duration<double>(Clock::now() - begin).count();
+
+        mutations += result.mutations;
+        initialMoves += result.initialMoves;
+        totalMoves += result.moveCount;
+        maxMoves = std::max(maxMoves, result.moveCount);
+        deepLevels += result.moveCount >= 15 ? 1 : 0;
+
+        field.Serialize(code);
+        output << code << "\t" << result.moveCount << "\t" << result.initialMoves << "\t" << result.solutionCount << "\t" << index << "\n";
+    }
+    output.flush();
+
+    std::cerr << "levels " << levelNum << " in " << optimizeSeconds << " s, moves avg "
+        << static_cast<double>(initialMoves) / levelNum << " -> " << static_cast<double>(totalMoves) / levelNum
+        << " max " << maxMoves << ", 15+ moves " << deepLevels << std::endl;
+    std::cerr << "  mutations " << mutations << " (" << mutations / optimizeSeconds << " mutations/s, one full solve each)" << std::endl;
+
+    return 0;
+}
+
+int LevelPipeline::RunDedup(int argc, char** argv)
+{
+    if (argc < 1)
+    {
+        std::cerr << "usage: dedup <input> [output]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream input(argv[0]);
+    if (!input)
+    {
+        std::cerr << "cannot open " << argv[0] << std::endl;
+        return 1;
+    }
+
+    std::ofstream file;
+    if (argc > 1)
+    {
+        file.open(argv[1]);
+        if (!file)
+        {
+            std::cerr << "cannot open " << argv[1] << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& output = file.is_open() ? file : std::cout;
+
+    // ハッシュが一致したものは正規形まで比べる（衝突した別の盤面を落とさないため）
+    std::unordered_multimap<uint64_t, game::Symmetry::Canonical> seen;
+    game::Symmetry::Canonical canonical;
+    game::Field field;
+    std::string line;
+    int levels = 0, duplicates = 0, invalid = 0;
+    Clock::duration elapsed = Clock::duration::zero();
+
+    while (std::getline(input, line))
+    {
+        if (!ParseLevelLine(line, field))
+        {
+            ++invalid;
+            continue;
+        }
+        ++levels;
+
+        const auto begin = Clock::now();
+        const bool canonicalized = game::Symmetry::Canonicalize(field, canonical);
+        elapsed += Clock::now() - begin;
+        if (!canonicalized)
+        {
+            ++invalid;
+            continue;
+        }
+
+        bool duplicate = false;
+        const auto range = seen.equal_range(canonical.hash);
+        for (auto it = range.first; it != range.second && !duplicate; ++it)
+        {
+            duplicate = it->second == canonical;
+        }
+        if (duplicate)
+        {
+            ++duplicates;
+            continue;
+        }
+
+        seen.emplace(canonical.hash, canonical);
+        output << line << "\n";
+    }
+    output.flush();
+
+    const double nanoseconds = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    std::cerr << "levels " << levels << ", unique " << levels - duplicates << ", duplicates " << duplicates
+        << ", invalid " << invalid << std::endl;
+    std::cerr << "  canonicalize " << nanoseconds / std::max(levels, 1) << " ns/board" << std::endl;
+
+    return 0;
+}
+
+int LevelPipeline::RunCluster(int argc, char** argv)
+{
+    if (argc < 1)
+    {
+        std::cerr << "usage: cluster <input> [output] [threshold]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream input(argv[0]);
+    if (!input)
+    {
+        std::cerr << "cannot open " << argv[0] << std::endl;
+        return 1;
+    }
+
+    std::ofstream file;
+    if (argc > 1)
+    {
+        file.open(argv[1]);
+        if (!file)
+        {
+            std::cerr << "cannot open " << argv[1] << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& output = file.is_open() ? file : std::cout;
+
+    game::NearDuplicateFinder::Parameter param;
+    if (argc > 2)
+    {
+        param.threshold = std::atof(argv[2]);
+    }
+
+    game::NearDuplicateFinder finder;
+    finder.Reset(param);
+    game::Field field;
+    std::vector<std::string> lines;
+    std::string line;
+    int invalid = 0;
+
+    const auto begin = Clock::now();
+    while (std::getline(input, line))
+    {
+        if (!ParseLevelLine(line, field) || !finder.Add(field))
+        {
+            ++invalid;
+            continue;
+        }
+        lines.push_back(line);
+    }
+    const auto added = Clock::now();
+
+    std::vector<uint32_t> clusters;
+    game::NearDuplicateFinder::Result result;
+    finder.Cluster(clusters, result);
+    const auto clustered = Clock::now();
+
+    for (size_t index = 0; index < lines.size(); ++index)
+    {
+        output << lines[index] << "\t" << clusters[index] << "\n";
+    }
+    output.flush();
+
+    const double addSeconds = std::chrono::duration<double>(added - begin).count();
+    const double clusterSeconds = std::chrono::duration<double>(clustered - added).count();
+    std::cerr << "levels " << lines.size() << ", clusters " << result.clusterNum << ", largest " << result.largestCluster
+        << ", invalid " << invalid << std::endl;
+    std::cerr << "  candidates " << result.candidatePairs << ", merged " << result.mergedPairs << std::endl;
+    std::cerr << "  parse + signature " << addSeconds << " s, cluster " << clusterSeconds << " s" << std::endl;
+
+    return 0;
+}
+
+int LevelPipeline::RunPack(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "usage: pack <input> <output> <seed> [bucketMinMoves...]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream input(argv[0]);
+    if (!input)
+    {
+        std::cerr << "cannot open " << argv[0] << std::endl;
+        return 1;
+    }
+    const uint64_t seed = std::strtoull(argv[2], nullptr, 10);
+
+    std::vector<int> bucketMinMoves;
+    for (int arg = 3; arg < argc; ++arg)
+    {
+        bucketMinMoves.push_back(std::atoi(argv[arg]));
+    }
+    if (bucketMinMoves.empty())
+    {
+        bucketMinMoves = { 1, 6, 10, 15 };
+    }
+
+    // 手数と最短解の数は入力の列に頼らず解き直して求める（番号だけは最後の列から取る）
+    // (seed, index) は生成器がそこから同じ盤面を作るときだけ残す（逆向きの生成や最適化で作ったものは作り直せない）
+    game::LevelGenerator generator;
+    game::LevelGenerator::Parameter generateParam;
+    generateParam.field.seed = seed;
+    game::Field origin;
+    std::string code, originCode;
+    game::RouteFinder finder;
+    game::RouteFinder::Parameter findParam;
+    findParam.countSolutions = true;
+    game::RouteFinder::Result found;
+    game::LevelPackBuilder builder;
+    game::Field field;
+    std::string line;
+    int invalid = 0, unsolved = 0, noOrigin = 0;
+
+    while (std::getline(input, line))
+    {
+        if (!ParseLevelLine(line, field))
+        {
+            ++invalid;
+            continue;
+        }
+        if (!finder.Find(field, findParam, found))
+        {
+            ++unsolved;
+            continue;
+        }
+
+        const size_t last = line.rfind('\t');
+        generateParam.field.index = last != std::string::npos ? std::strtoull(line.c_str() + last + 1, nullptr, 10) : 0;
+        bool reproducible = false;
+        if (last != std::string::npos && generator.CreateCandidate(generateParam, origin))
+        {
+            field.Serialize(code);
+            origin.Serialize(originCode);
+            reproducible = originCode == code;
+        }
+        noOrigin += reproducible ? 0 : 1;
+        const uint64_t entrySeed = reproducible ? seed : game::LevelPack::NoOrigin;
+        const uint64_t entryIndex = reproducible ? generateParam.field.index : game::LevelPack::NoOrigin;
+        if (!builder.Add(field, found.moveCount, found.solutionCount, entrySeed, entryIndex))
+        {
+            ++invalid;
+        }
+    }
+
+    std::vector<uint8_t> pack;
+    builder.Build(bucketMinMoves, pack);
+
+    std::ofstream output(argv[1], std::ios::binary);
+    if (!output)
+    {
+        std::cerr << "cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+    output.write(reinterpret_cast<const char*>(pack.data()), pack.size());
+
+    std::cerr << "levels " << builder.GetLevelNum() << ", invalid " << invalid << ", unsolved " << unsolved
+        << ", without (seed, index) " << noOrigin << ", " << pack.size() << " bytes" << std::endl;
+    return 0;
+}
+
+int LevelPipeline::RunPackInfo(int argc, char** argv)
+{
+    if (argc < 1)
+    {
+        std::cerr << "usage: pack-info <pack> [samples]" << std::endl;
+        return 1;
+    }
+    const int samples = argc > 1 ? std::atoi(argv[1]) : 16;
+
+    const auto begin = Clock::now();
+    MappedFile file;
+    game::LevelPack pack;
+    if (!file.Open(argv[0]) || !pack.Open(file.GetData(), file.GetSize()))
+    {
+        std::cerr << "cannot open " << argv[0] << std::endl;
+        return 1;
+    }
+    const double openMicroseconds = std::chrono::duration<double, std::micro>(Clock::now() - begin).count();
+
+    std::cerr << "levels " << pack.GetLevelNum() << ", " << file.GetSize() << " bytes, opened in "
+        << openMicroseconds << " us" << std::endl;
+
+    game::RouteFinder finder;
+    game::RouteFinder::Parameter findParam;
+    game::RouteFinder::Result found;
+    game::Random random(0);
+    game::Field field;
+    int mismatches = 0;
+    Clock::duration loading = Clock::duration::zero();
+    int loaded = 0;
+
+    for (uint32_t bucket = 0; bucket < pack.GetBucketNum(); ++bucket)
+    {
+        const auto& info = pack.GetBucket(bucket);
+        std::cerr << "  bucket " << bucket << "\t" << info.minMoves << "-" << info.maxMoves << " moves\t" << info.count << " levels" << std::endl;
+
+        uint32_t level = 0;
+        for (int sample = 0; sample < samples && pack.PickLevel(bucket, random, level); ++sample)
+        {
+            const auto start = Clock::now();
+            const bool loadedLevel = pack.Load(level, field);
+            loading += Clock::now() - start;
+            ++loaded;
+
+            const auto& entry = pack.GetEntry(level);
+            if (!loadedLevel || !finder.Find(field, findParam, found) || found.moveCount != entry.moveCount)
+            {
+                ++mismatches;
+            }
+        }
+    }
+
+    const double loadNanoseconds = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(loading).count());
+    std::cerr << "  loaded " << loaded << " levels (" << loadNanoseconds / std::max(loaded, 1) << " ns/level), mismatches "
+        << mismatches << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+int LevelPipeline::RunEstimate(int argc, char** argv)
+{
+    if (argc < 1)
+    {
+        std::cerr << "usage: estimate <input> [playouts] [maxMoves] [greedy] [output]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream input(argv[0]);
+    if (!input)
+    {
+        std::cerr << "cannot open " << argv[0] << std::endl;
+        return 1;
+    }
+
+    game::PlayoutEstimator::Parameter param;
+    if (argc > 1)
+    {
+        param.playouts = std::atoi(argv[1]);
+    }
+    if (argc > 2)
+    {
+        param.maxMoves = std::atoi(argv[2]);
+    }
+    if (argc > 3)
+    {
+        param.greedy = std::atof(argv[3]);
+    }
+
+    std::ofstream file;
+    if (argc > 4)
+    {
+        file.open(argv[4]);
+        if (!file)
+        {
+            std::cerr << "cannot open " << argv[4] << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& output = file.is_open() ? file : std::cout;
+
+    game::PlayoutEstimator estimator;
+    game::PlayoutEstimator::Result result;
+    game::Field field;
+    std::string line;
+    int levels = 0, invalid = 0;
+    uint64_t simulatedMoves = 0;
+    double seconds = 0.0;
+
+    while (std::getline(input, line))
+    {
+        if (!ParseLevelLine(line, field))
+        {
+            ++invalid;
+            continue;
+        }
+
+        // 同じ盤面からはファイル内の位置によらず同じ見積もりになるよう、シードは盤面のハッシュから決める
+        param.seed = game::Random::Mix(field.GetHash());
+        const auto begin = Clock::now();
+        if (!estimator.Estimate(field, param, result))
+        {
+            ++invalid;
+            continue;
+        }
+        seconds += std::chrono::duration<double>(Clock::now() - begin).count();
+        simulatedMoves += result.simulatedMoves;
+        ++levels;
+
+        const size_t last = line.rfind('\t');
+        const size_t split = last != std::string::npos ? last : line.size();
+        output << line.substr(0, split) << "\t" << result.successRate << "\t" << result.averageMoves << line.substr(split) << "\n";
+    }
+    output.flush();
+
+    std::cerr << "levels " << levels << ", invalid " << invalid << ", " << simulatedMoves << " moves in " << seconds
+        << " s (" << simulatedMoves / std::max(seconds, 1e-9) / 1e6 << "M moves/s)" << std::endl;
+    return 0;
+}
+
+} // namespace prototype
@@ -0,0 +1,206 @@
+#include "NearDuplicateFinder.h"
+
+#include "Random.h"
+#include <algorithm>
+#include <limits>
+
+namespace game
+{
+
+NearDuplicateFinder::NearDuplicateFinder()
+    : m_Param()
+    , m_Multipliers()
+    , m_Offsets()
+    , m_Signatures()
+    , m_Features()
+    , m_Band()
+    , m_Parents()
+    , m_Count(0)
+{
+    Reset(m_Param);
+}
+
+NearDuplicateFinder::~NearDuplicateFinder()
+{
+
+}
+
+void NearDuplicateFinder::Reset(const Parameter& param)
+{
+    _ASSERT(param.hashNum > 0 && param.bandNum > 0 && param.hashNum % param.bandNum == 0);
+
+    m_Param = param;
+    m_Signatures.clear();
+    m_Count = 0;
+
+    Random random(param.seed);
+    m_Multipliers.resize(param.hashNum);
+    m_Offsets.resize(param.hashNum);
+    for (int hash = 0; hash < param.hashNum; ++hash)
+    {
+        m_Multipliers[hash] = random.Next() | 1;
+        m_Offsets[hash] = random.Next();
+    }
+}
+
+bool NearDuplicateFinder::Add(const Field& field)
+{
+    Symmetry::Canonical canonical;
+    if (!Symmetry::Canonicalize(field, canonical))
+    {
+        return false;
+    }
+    return Add(canonical);
+}
+
+bool NearDuplicateFinder::Add(const Symmetry::Canonical& canonical)
+{
+    // 特徴は (面, y, x) を一つの整数にしたもの
+    // 外周のブロックはどの盤面にもあって似ているように見せるだけなので除く
+    const int planeNum = static_cast<int>(Symmetry::Plane::Num);
+    const int width = canonical.width, height = canonical.height;
+    const uint32_t inner = width > 2 ? ((1u << (width - 1)) - 1) & ~1u : 0;
+
+    m_Features.clear();
+    for (int plane = 0; plane < planeNum; ++plane)
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            uint32_t row = canonical.rows[plane][y];
+            if (plane == static_cast<int>(Symmetry::Plane::Block))
+            {
+                row = (y == 0 || y == height - 1) ? 0 : row & inner;
+            }
+            for (int x = 0; row != 0; ++x, row >>= 1)
+            {
+                if (row & 1)
+                {
+                    m_Features.push_back((static_cast<uint64_t>(plane) << 16) | (y << 8) | x);
+                }
+            }
+        }
+    }
+    m_Features.push_back((static_cast<uint64_t>(planeNum) << 16) | (canonical.goal.y << 8) | canonical.goal.x);
+    m_Features.push_back((static_cast<uint64_t>(planeNum + 1) << 16) | (canonical.mainPiece.y << 8) | canonical.mainPiece.x);
+
+    // 大きさの違う盤面が同じ特徴を持たないよう、大きさも混ぜる
+    const uint64_t size = (static_cast<uint64_t>(width) << 40) | (static_cast<uint64_t>(height) << 32);
+    for (auto& feature : m_Features)
+    {
+        feature = Random::Mix(feature | size);
+    }
+
+    const size_t offset = m_Signatures.size();
+    m_Signatures.resize(offset + m_Param.hashNum, std::numeric_limits<uint32_t>::max());
+    uint32_t* signature = &m_Signatures[offset];
+    for (int hash = 0; hash < m_Param.hashNum; ++hash)
+    {
+        const uint64_t multiplier = m_Multipliers[hash], add = m_Offsets[hash];
+        uint32_t minimum = std::numeric_limits<uint32_t>::max();
+        for (const auto feature : m_Features)
+        {
+            minimum = std::min(minimum, static_cast<uint32_t>((multiplier * feature + add) >> 32));
+        }
+        signature[hash] = minimum;
+    }
+
+    ++m_Count;
+    return true;
+}
+
+void NearDuplicateFinder::Cluster(std::vector<uint32_t>& clusters, Result& result)
+{
+    result = Result();
+
+    const uint32_t count = static_cast<uint32_t>(m_Count);
+    const int rowsPerBand = m_Param.hashNum / m_Param.bandNum;
+    m_Parents.resize(count);
+    for (uint32_t index = 0; index < count; ++index)
+    {
+        m_Parents[index] = index;
+    }
+
+    // 帯ごとに (帯のハッシュ, 番号) を並べ替え、同じハッシュが続く範囲を先頭の盤面と比べる
+    m_Band.resize(count);
+    for (int band = 0; band < m_Param.bandNum; ++band)
+    {
+        for (uint32_t index = 0; index < count; ++index)
+        {
+            const uint32_t* rows = &m_Signatures[static_cast<size_t>(index) * m_Param.hashNum + band * rowsPerBand];
+            uint64_t key = Random::Mix(static_cast<uint64_t>(band));
+            for (int row = 0; row < rowsPerBand; ++row)
+            {
+                key = Random::Mix(key ^ rows[row]);
+            }
+            m_Band[index].key = key;
+            m_Band[index].index = index;
+        }
+        std::sort(m_Band.begin(), m_Band.end());
+
+        for (uint32_t begin = 0, end = 0; begin < count; begin = end)
+        {
+            for (end = begin + 1; end < count && m_Band[end].key == m_Band[begin].key; ++end)
+            {
+                const uint32_t first = m_Band[begin].index, other = m_Band[end].index;
+                if (Find(first) == Find(other))
+                {
+                    continue;
+                }
+                ++result.candidatePairs;
+                if (GetSimilarity(first, other) >= m_Param.threshold)
+                {
+                    ++result.mergedPairs;
+                    Unite(first, other);
+                }
+            }
+        }
+    }
+
+    // 代表は組の中で最も小さい番号（Unite で小さいほうを親にしている）
+    std::vector<uint32_t> sizes(count, 0);
+    clusters.resize(count);
+    for (uint32_t index = 0; index < count; ++index)
+    {
+        clusters[index] = Find(index);
+        const uint32_t size = ++sizes[clusters[index]];
+        result.clusterNum += clusters[index] == index ? 1 : 0;
+        result.largestCluster = std::max(result.largestCluster, static_cast<int>(size));
+    }
+}
+
+double NearDuplicateFinder::GetSimilarity(const size_t a, const size_t b) const
+{
+    const uint32_t* lhs = &m_Signatures[a * m_Param.hashNum];
+    const uint32_t* rhs = &m_Signatures[b * m_Param.hashNum];
+    int same = 0;
+    for (int hash = 0; hash < m_Param.hashNum; ++hash)
+    {
+        same += lhs[hash] == rhs[hash] ? 1 : 0;
+    }
+    return static_cast<double>(same) / m_Param.hashNum;
+}
+
+uint32_t NearDuplicateFinder::Find(uint32_t index)
+{
+    while (m_Parents[index] != index)
+    {
+        m_Parents[index] = m_Parents[m_Parents[index]];
+        index = m_Parents[index];
+    }
+    return index;
+}
+
+void NearDuplicateFinder::Unite(const uint32_t a, const uint32_t b)
+{
+    const uint32_t rootA = Find(a), rootB = Find(b);
+    if (rootA < rootB)
+    {
+        m_Parents[rootB] = rootA;
+    }
+    else if (rootB < rootA)
+    {
+        m_Parents[rootA] = rootB;
+    }
+}
+
+} // namespace game
@@ -0,0 +1,337 @@
+#include "ReverseGenerator.h"
+
+#include <algorithm>
+
+namespace game
+{
+
+ReverseGenerator::ReverseGenerator()
+    : m_Random()
+    , m_Finder()
+    , m_Terrain()
+    , m_Distances()
+    , m_Predecessors()
+    , m_Layer()
+    , m_NextLayer()
+    , m_Width(0)
+    , m_PieceCount(0)
+    , m_Bits(0)
+{
+
+}
+
+ReverseGenerator::~ReverseGenerator()
+{
+
+}
+
+bool ReverseGenerator::Generate(const Parameter& param, Field& field, Result& result)
+{
+    result = Result();
+
+    if (param.pieceNum < 1 || param.pieceNum > GameState::MaxPieces || !field.Create(param.field))
+    {
+        return false;
+    }
+
+    // 地形と同じ (seed, index) から派生させ、同じ番号なら同じ問題になるようにする
+    m_Random = Random(param.field.seed, param.field.index).Split(1);
+
+    m_Width = field.GetWidth();
+    m_PieceCount = param.pieceNum;
+    m_Bits = 1;
+    while ((1 << m_Bits) < field.GetWidth() * field.GetHeight())
+    {
+        ++m_Bits;
+    }
+    if (m_Bits * m_PieceCount > 63)
+    {
+        return false;
+    }
+
+    m_Terrain.Reset(field);
+
+    // クリア状態の置き方をいくつも用意して同じビームに入れ、どこから始めたかによらず伸びる状態を残す
+    m_Distances.clear();
+    m_Layer.clear();
+    for (int root = 0; root < param.rootNum; ++root)
+    {
+        int cells[GameState::MaxPieces];
+        if (!PlaceSolvedPieces(param.pieceNum, cells))
+        {
+            return false;
+        }
+        const uint64_t state = Pack(cells);
+        if (m_Distances.emplace(state, 0).second)
+        {
+            m_Layer.push_back(state);
+        }
+    }
+
+    std::vector<Field::Position> best;
+    Walk(param, best, result);
+    if (best.empty())
+    {
+        return false;
+    }
+
+    field.SetPieces(best);
+    return true;
+}
+
+void ReverseGenerator::Walk(const Parameter& param, std::vector<Field::Position>& best, Result& result)
+{
+    // 最短手数が d の状態から一手戻した状態の最短手数は d + 1 を超えないので、d 手以内で解けなければちょうど d + 1 とわかる
+    // ちょうど d + 1 になったものだけを次の層に積み（サブピースを動かしただけなど、伸びないものは捨てる）、
+    // そこから beamWidth 個を残して次の手数へ進む
+    // （一手前の状態を間引くと深くまで伸びる並びを取りこぼしやすいので、残した状態からはすべて戻す）
+    GameState candidate = GameState();
+    candidate.pieceNum = static_cast<uint8_t>(param.pieceNum);
+    int cells[GameState::MaxPieces];
+
+    RouteFinder::Parameter findParam;
+    RouteFinder::Result found;
+    int steps = 0;
+
+    for (int depth = 0; depth < param.maxDepth && !m_Layer.empty() && steps < param.maxSteps; ++depth)
+    {
+        m_NextLayer.clear();
+        for (size_t layer = 0; layer < m_Layer.size() && steps < param.maxSteps; ++layer)
+        {
+            Unpack(m_Layer[layer], cells);
+            m_Predecessors.clear();
+            ExpandReverse(cells, m_Predecessors);
+
+            for (const auto state : m_Predecessors)
+            {
+                if (steps >= param.maxSteps)
+                {
+                    break;
+                }
+                if (m_Distances.count(state) > 0)
+                {
+                    continue;
+                }
+
+                // 一手進めた先に最短手数が d 未満の状態があれば、この状態も d 手以内で解けるので解かずに捨てる
+                Unpack(state, cells);
+                const int successor = GetKnownSuccessorDistance(cells);
+                if (successor >= 0 && successor < depth)
+                {
+                    m_Distances.emplace(state, successor + 1);
+                    continue;
+                }
+
+                ++steps;
+                findParam.maxMoves = depth;
+                for (int piece = 0; piece < param.pieceNum; ++piece)
+                {
+                    candidate.pieces[piece] = static_cast<CellIndex>(cells[piece]);
+                }
+                int distance = depth + 1;
+                if (m_Finder.Find(m_Terrain, candidate, findParam, found))
+                {
+                    distance = found.moveCount;
+                }
+                else if (found.visitedStates >= findParam.maxStates || m_Finder.GetArena().HasFailed())
+                {
+                    continue;
+                }
+                m_Distances.emplace(state, distance);
+
+                if (distance == depth + 1)
+                {
+                    m_NextLayer.push_back(state);
+                }
+            }
+        }
+        if (m_NextLayer.empty())
+        {
+            break;
+        }
+
+        // 積んだ順に残すと先に戻した状態の子ばかりになるので、混ぜてから残す
+        m_Random.Shuffle(m_NextLayer.begin(), m_NextLayer.end());
+        if (static_cast<int>(m_NextLayer.size()) > param.beamWidth)
+        {
+            m_NextLayer.resize(param.beamWidth);
+        }
+        m_Layer.swap(m_NextLayer);
+
+        result.moveCount = depth + 1;
+        Unpack(m_Layer.front(), cells);
+        best.resize(param.pieceNum);
+        for (int piece = 0; piece < param.pieceNum; ++piece)
+        {
+            best[piece] = Field::Position(cells[piece] % m_Width, cells[piece] / m_Width);
+        }
+    }
+    result.visitedStates = m_Distances.size();
+}
+
+int ReverseGenerator::GetKnownSuccessorDistance(const int* cells) const
+{
+    const int steps[] = { -m_Width, -1, 1, m_Width };
+    int moved[GameState::MaxPieces];
+    int known = -1;
+
+    for (int piece = 0; piece < m_PieceCount; ++piece)
+    {
+        for (const int step : steps)
+        {
+            int to = cells[piece];
+            while (m_Terrain.IsWalkable(to + step) && !IsOccupied(cells, to + step))
+            {
+                to += step;
+            }
+            if (to == cells[piece])
+            {
+                continue;
+            }
+            // メインピースがクリア位置に止まれば一手で解ける
+            if (piece == 0 && m_Terrain.IsClearCell(to))
+            {
+                return 0;
+            }
+
+            std::copy(cells, cells + m_PieceCount, moved);
+            moved[piece] = to;
+            Normalize(moved);
+            const auto distance = m_Distances.find(Pack(moved));
+            if (distance != m_Distances.end() && (known < 0 || distance->second < known))
+            {
+                known = distance->second;
+            }
+        }
+    }
+    return known;
+}
+
+bool ReverseGenerator::PlaceSolvedPieces(const int pieceNum, int* cells)
+{
+    // メインピースはゴールの隣、サブピースはそれ以外で壁に接しているセルに置く
+    // （壁に接していないセルには滑ってきて止まることがないので、そこに置いたピースは逆向きに動かせない）
+    const int steps[] = { -m_Width, -1, 1, m_Width };
+    std::vector<int> goalCells, freeCells;
+    for (int index = 0, size = m_Terrain.GetWidth() * m_Terrain.GetHeight(); index < size; ++index)
+    {
+        if (!m_Terrain.IsWalkable(index))
+        {
+            continue;
+        }
+        if (m_Terrain.IsClearCell(index))
+        {
+            goalCells.push_back(index);
+            continue;
+        }
+        for (const int step : steps)
+        {
+            if (!m_Terrain.IsWalkable(index + step))
+            {
+                freeCells.push_back(index);
+                break;
+            }
+        }
+    }
+
+    if (goalCells.empty() || static_cast<int>(freeCells.size()) < pieceNum - 1)
+    {
+        return false;
+    }
+
+    cells[0] = goalCells[m_Random.Below(static_cast<uint32_t>(goalCells.size()))];
+
+    m_Random.Shuffle(freeCells.begin(), freeCells.end());
+    for (int index = 1; index < pieceNum; ++index)
+    {
+        cells[index] = freeCells[index - 1];
+    }
+    Normalize(cells);
+    return true;
+}
+
+void ReverseGenerator::ExpandReverse(const int* cells, std::vector<uint64_t>& next)
+{
+    const int steps[] = { -m_Width, -1, 1, m_Width };
+    int moved[GameState::MaxPieces];
+
+    for (int piece = 0; piece < m_PieceCount; ++piece)
+    {
+        const int at = cells[piece];
+
+        for (const int step : steps)
+        {
+            // 進行方向の先が塞がっていなければ、この方向に滑ってきてここで止まることはない
+            const int ahead = at + step;
+            if (m_Terrain.IsWalkable(ahead) && !IsOccupied(cells, ahead))
+            {
+                continue;
+            }
+
+            // 来た方向へ一つずつ戻り、そこから滑ればここで止まる位置をすべて前の状態とする
+            for (int from = at - step; m_Terrain.IsWalkable(from) && !IsOccupied(cells, from); from -= step)
+            {
+                // 前の状態でメインピースがすでにクリア位置に止まっていると、そこで終わってしまう
+                // （クリアを確かめるのは止まったセルだけなので、その先から通り抜けてくる状態は残す）
+                if (piece == 0 && m_Terrain.IsClearCell(from))
+                {
+                    continue;
+                }
+
+                std::copy(cells, cells + m_PieceCount, moved);
+                moved[piece] = from;
+                Normalize(moved);
+                next.push_back(Pack(moved));
+            }
+        }
+    }
+}
+
+// サブピースは区別しないので、並べ替えて同一視する
+void ReverseGenerator::Normalize(int* cells) const
+{
+    for (int i = 2; i < m_PieceCount; ++i)
+    {
+        const int value = cells[i];
+        int j = i - 1;
+        while (j >= 1 && cells[j] > value)
+        {
+            cells[j + 1] = cells[j];
+            --j;
+        }
+        cells[j + 1] = value;
+    }
+}
+
+uint64_t ReverseGenerator::Pack(const int* cells) const
+{
+    uint64_t state = 0;
+    for (int index = 0; index < m_PieceCount; ++index)
+    {
+        state |= static_cast<uint64_t>(cells[index]) << (index * m_Bits);
+    }
+    return state;
+}
+
+void ReverseGenerator::Unpack(const uint64_t state, int* cells) const
+{
+    const uint64_t mask = (1ull << m_Bits) - 1;
+    for (int index = 0; index < m_PieceCount; ++index)
+    {
+        cells[index] = static_cast<int>((state >> (index * m_Bits)) & mask);
+    }
+}
+
+bool ReverseGenerator::IsOccupied(const int* cells, const int cell) const
+{
+    for (int index = 0; index < m_PieceCount; ++index)
+    {
+        if (cells[index] == cell)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace game
@@ -1,2 +1,678 @@
 #include "RouteFinder.h"
 
+#if defined(_M_X64) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define GAME_ROUTE_FINDER_PREFETCH 1
+#endif
+
+namespace game
+{
+
+namespace
+{
+
+constexpr int SolverDirectionNum = static_cast<int>(Field::Direction::Num);
+
+// 状態は 63bit 以下に収まるので、全ビットが立った値は出現しない
+constexpr uint64_t SolverEmptyKey = ~0ull;
+
+constexpr int BitsForCells(const int cellCount)
+{
+    int bits = 1;
+    while ((1 << bits) < cellCount)
+    {
+        ++bits;
+    }
+    return bits;
+}
+
+// 探索で引く盤面の表（停止位置とクリア判定は Terrain が前計算したものを使う）
+struct SolverBoard
+{
+    int width;
+    int height;
+    const uint16_t* stops;  // (セル * 4 + 方向) から、地形だけを見たときに止まるセル
+    const uint8_t* goals;   // メインピースがここで止まればクリア
+    const uint8_t* bounds;  // メインピースがクリアするまでに少なくとも要る手数
+
+    void Build(const Terrain& terrain)
+    {
+        width = terrain.GetWidth();
+        height = terrain.GetHeight();
+        stops = terrain.GetStops();
+        goals = terrain.GetGoals();
+        bounds = terrain.GetClearBounds();
+    }
+};
+
+// 状態を積む領域は固定サイズのチャンクに分けて取り、広げるときに積んだ要素をコピーしない
+constexpr size_t SolverChunkBytes = 64 * 1024;
+
+// 一度の探索で使った Arena は、この大きさまでなら次の探索のために持ち続ける
+// （20x20 / 4 ピースで数百万状態を調べる探索が収まる大きさ）
+constexpr size_t SolverRetainedBytes = 512 * 1024 * 1024;
+
+// チャンクの払い出し元
+// 探索済み状態の表を広げた後の古い表はチャンクに切り分けて使い回すので、広げた跡が Arena に残らない
+class SolverChunkPool
+{
+public:
+    explicit SolverChunkPool(Arena& arena)
+        : m_Arena(arena)
+        , m_Free(nullptr)
+    {}
+
+    void* Allocate()
+    {
+        if (m_Free == nullptr)
+        {
+            return m_Arena.Allocate(SolverChunkBytes, alignof(uint64_t));
+        }
+        FreeChunk* chunk = m_Free;
+        m_Free = chunk->next;
+        return chunk;
+    }
+
+    // 使わなくなった領域を引き取る（チャンクに満たない端は捨てる）
+    void Recycle(void* data, const size_t bytes)
+    {
+        uint8_t* chunk = static_cast<uint8_t*>(data);
+        for (size_t offset = 0; offset + SolverChunkBytes <= bytes; offset += SolverChunkBytes)
+        {
+            FreeChunk* free = reinterpret_cast<FreeChunk*>(chunk + offset);
+            free->next = m_Free;
+            m_Free = free;
+        }
+    }
+
+private:
+    struct FreeChunk
+    {
+        FreeChunk* next;
+    };
+
+    Arena& m_Arena;
+    FreeChunk* m_Free;
+};
+
+// チャンクを並べた可変長配列（要素の位置は積んだ後も変わらない）
+template <class T>
+class SolverChunkedArray
+{
+public:
+    static constexpr size_t ChunkSize = SolverChunkBytes / sizeof(T);
+    static_assert((ChunkSize & (ChunkSize - 1)) == 0, "chunk size must be a power of two");
+
+    SolverChunkedArray(SolverChunkPool& pool, Arena& arena)
+        : m_Pool(pool)
+        , m_Chunks(arena)
+        , m_Size(0)
+    {}
+
+    // 確保できなければ false を返す（Arena の HasFailed も true になる）
+    bool PushBack(const T& value)
+    {
+        if ((m_Size & (ChunkSize - 1)) == 0)
+        {
+            T* chunk = static_cast<T*>(m_Pool.Allocate());
+            if (chunk == nullptr || !m_Chunks.PushBack(chunk))
+            {
+                return false;
+            }
+        }
+        m_Chunks[m_Size / ChunkSize][m_Size & (ChunkSize - 1)] = value;
+        ++m_Size;
+        return true;
+    }
+
+    const T& operator[](const size_t index) const { return m_Chunks[index / ChunkSize][index & (ChunkSize - 1)]; }
+    size_t Size() const { return m_Size; }
+
+private:
+    SolverChunkPool& m_Pool;
+    ArenaVector<T*> m_Chunks;   // チャンクの先頭（ポインタだけなので、広げるときのコピーはわずか）
+    size_t m_Size;
+};
+
+// 探索済み状態の集合（オープンアドレス法）
+class SolverStateTable
+{
+public:
+    SolverStateTable(SolverChunkPool& pool, Arena& arena, const size_t expected)
+        : m_Pool(pool)
+        , m_Arena(arena)
+        , m_Keys(nullptr)
+        , m_Capacity(1024)
+        , m_Count(0)
+    {
+        while (m_Capacity < expected * 2)
+        {
+            m_Capacity <<= 1;
+        }
+        m_Keys = Allocate(m_Arena, m_Capacity);
+    }
+
+    // 入れる前に、調べる位置をキャッシュに読み込ませておく
+    void Prefetch(const uint64_t key) const
+    {
+#if defined(GAME_ROUTE_FINDER_PREFETCH)
+        if (m_Keys != nullptr)
+        {
+            _mm_prefetch(reinterpret_cast<const char*>(&m_Keys[Slot(key, m_Capacity)]), _MM_HINT_T0);
+        }
+#else
+        (void)key;
+#endif
+    }
+
+    // 入れられなかった（既にあるか、表を広げられなかった）ときは false を返す
+    bool Insert(const uint64_t key)
+    {
+        if (m_Keys == nullptr)
+        {
+            return false;
+        }
+        if ((m_Count + 1) * 2 > m_Capacity && !Grow())
+        {
+            return false;
+        }
+        if (!InsertKey(m_Keys, m_Capacity, key))
+        {
+            return false;
+        }
+        ++m_Count;
+        return true;
+    }
+
+private:
+    static uint64_t* Allocate(Arena& arena, const size_t capacity)
+    {
+        uint64_t* keys = arena.AllocateArray<uint64_t>(capacity);
+        if (keys == nullptr)
+        {
+            return nullptr;
+        }
+        for (size_t index = 0; index < capacity; ++index)
+        {
+            keys[index] = SolverEmptyKey;
+        }
+        return keys;
+    }
+
+    static size_t Slot(const uint64_t key, const size_t capacity)
+    {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 20) & (capacity - 1);
+    }
+
+    static bool InsertKey(uint64_t* keys, const size_t capacity, const uint64_t key)
+    {
+        const size_t mask = capacity - 1;
+        size_t index = Slot(key, capacity);
+        while (keys[index] != SolverEmptyKey)
+        {
+            if (keys[index] == key)
+            {
+                return false;
+            }
+            index = (index + 1) & mask;
+        }
+        keys[index] = key;
+        return true;
+    }
+
+    // 古い表は移し終えたらチャンクとして状態を積むのに回す
+    bool Grow()
+    {
+        const size_t capacity = m_Capacity * 2;
+        uint64_t* keys = Allocate(m_Arena, capacity);
+        if (keys == nullptr)
+        {
+            return false;
+        }
+        for (size_t index = 0; index < m_Capacity; ++index)
+        {
+            if (m_Keys[index] != SolverEmptyKey)
+            {
+                InsertKey(keys, capacity, m_Keys[index]);
+            }
+        }
+        m_Pool.Recycle(m_Keys, m_Capacity * sizeof(uint64_t));
+        m_Keys = keys;
+        m_Capacity = capacity;
+        return true;
+    }
+
+private:
+    SolverChunkPool& m_Pool;
+    Arena& m_Arena;
+    uint64_t* m_Keys;
+    size_t m_Capacity;
+    size_t m_Count;
+};
+
+// 探索の本体
+// W, H, N に 0 を指定すると実行時の値を使う汎用カーネルになる
+// 固定値を指定した場合はセル番号の計算、状態の詰め込み、ループ回数がすべてコンパイル時に決まる
+template <int W, int H, int N>
+class SolverKernel
+{
+public:
+    static constexpr bool IsSpecialized = (W > 0 && H > 0 && N > 0);
+    static constexpr int FixedBits = IsSpecialized ? BitsForCells(W * H) : 0;
+
+    SolverKernel(const SolverBoard& board, const int pieceCount, Arena& arena)
+        : m_Board(board)
+        , m_PieceCount(pieceCount)
+        , m_Bits(BitsForCells(board.width * board.height))
+        , m_Arena(arena)
+        , m_Pool(arena)
+        , m_Table(m_Pool, arena, 4096)
+        , m_States(m_Pool, arena)
+        , m_Parents(m_Pool, arena)
+        , m_Moves(m_Pool, arena)
+    {
+
+    }
+
+    static bool Supports(const int width, const int height, const int pieceCount)
+    {
+        if (IsSpecialized)
+        {
+            return width == W && height == H && pieceCount == N;
+        }
+        return pieceCount > 0 && pieceCount <= GameState::MaxPieces
+            && width * height <= 0xffff
+            && BitsForCells(width * height) * pieceCount <= 63;
+    }
+
+    // pieces は並べ替え前のピースのセル（手順はこの順番のピース番号で返す）
+    bool Search(const CellIndex* pieces, const RouteFinder::Parameter& param, RouteFinder::Result& result)
+    {
+        int cells[GameState::MaxPieces];
+        for (int index = 0; index < PieceCount(); ++index)
+        {
+            cells[index] = pieces[index];
+        }
+        Normalize(cells);
+
+        const uint64_t root = Pack(cells);
+        m_Table.Insert(root);
+        Push(root, 0, 0);
+        if (m_Arena.HasFailed())
+        {
+            return false;
+        }
+
+        if (m_Board.goals[cells[0]])
+        {
+            result.solved = true;
+            result.solutionCount = 1;
+            result.visitedStates = m_States.Size();
+            return true;
+        }
+
+        size_t begin = 0, end = m_States.Size();
+        for (int depth = 0; depth < param.maxMoves && begin < end; ++depth)
+        {
+            // 次の層から使える残りの手数（メインピースの手数の下限がこれを超える状態は積まない）
+            const int slack = param.maxMoves - depth - 1;
+            for (size_t node = begin; node < end; ++node)
+            {
+                Unpack(m_States[node], cells);
+
+                // メインピースが動かない手は下限を変えないので、超えていればサブピースは動かさない
+                const int pieceCount = m_Board.bounds[cells[0]] <= slack ? PieceCount() : 1;
+
+                // 一つの状態から進めた状態をまとめて求め、表を引く位置を先読みしてから順に積む
+                Successor successors[GameState::MaxPieces * SolverDirectionNum];
+                int successorNum = 0;
+                for (int piece = 0; piece < pieceCount; ++piece)
+                {
+                    Collect<0>(cells, piece, slack, successors, successorNum);
+                    Collect<1>(cells, piece, slack, successors, successorNum);
+                    Collect<2>(cells, piece, slack, successors, successorNum);
+                    Collect<3>(cells, piece, slack, successors, successorNum);
+                }
+                for (int index = 0; index < successorNum; ++index)
+                {
+                    m_Table.Prefetch(successors[index].state);
+                }
+                for (int index = 0; index < successorNum; ++index)
+                {
+                    if (Expand(successors[index], node))
+                    {
+                        if (!Reconstruct(pieces, result))
+                        {
+                            result.visitedStates = m_States.Size();
+                            return false;
+                        }
+                        if (param.countSolutions)
+                        {
+                            result.solutionCount = CountSolutions(begin, end);
+                        }
+                        return true;
+                    }
+                }
+
+                // 領域を確保できなくなったら打ち切る
+                if (m_States.Size() >= param.maxStates || m_Arena.HasFailed())
+                {
+                    result.visitedStates = m_States.Size();
+                    return false;
+                }
+            }
+
+            begin = end;
+            end = m_States.Size();
+        }
+
+        result.visitedStates = m_States.Size();
+        return false;
+    }
+
+private:
+    int Width() const { return W > 0 ? W : m_Board.width; }
+    int PieceCount() const { return N > 0 ? N : m_PieceCount; }
+    int Bits() const { return IsSpecialized ? FixedBits : m_Bits; }
+
+    static constexpr int StepOf(const int direction, const int width)
+    {
+        return direction == 0 ? -width : direction == 1 ? -1 : direction == 2 ? 1 : width;
+    }
+
+    // 指定したピースを指定方向に滑らせた先のセルを求める
+    template <int D>
+    int Slide(const int* cells, const int piece) const
+    {
+        const int from = cells[piece];
+        int to = m_Board.stops[from * 4 + D];
+        if (to == from)
+        {
+            return from;
+        }
+
+        const int step = StepOf(D, Width());
+        for (int other = 0; other < PieceCount(); ++other)
+        {
+            const int p = cells[other];
+            if (other == piece)
+            {
+                continue;
+            }
+
+            if (step > 0)
+            {
+                if (p > from && p <= to && (p - from) % step == 0)
+                {
+                    to = p - step;
+                }
+            }
+            else
+            {
+                if (p < from && p >= to && (from - p) % -step == 0)
+                {
+                    to = p - step;
+                }
+            }
+        }
+        return to;
+    }
+
+    struct Successor
+    {
+        uint64_t state;
+        uint8_t move;
+        bool goal;
+    };
+
+    // 一手分の状態を求めて successors に加える
+    // 下限は一手で高々 1 しか減らないので、残りの手数で解けない状態から先は最短手順にならない
+    template <int D>
+    void Collect(const int* cells, const int piece, const int slack, Successor* successors, int& successorNum) const
+    {
+        const int to = Slide<D>(cells, piece);
+        if (to == cells[piece] || (piece == 0 && m_Board.bounds[to] > slack))
+        {
+            return;
+        }
+
+        int next[GameState::MaxPieces];
+        for (int index = 0; index < PieceCount(); ++index)
+        {
+            next[index] = cells[index];
+        }
+        next[piece] = to;
+        Normalize(next);
+
+        Successor& successor = successors[successorNum++];
+        successor.state = Pack(next);
+        successor.move = static_cast<uint8_t>((piece << 2) | D);
+        successor.goal = piece == 0 && m_Board.goals[to];
+    }
+
+    // 一手分を積み、ゴールに到達したら true を返す
+    bool Expand(const Successor& successor, const size_t node)
+    {
+        if (!m_Table.Insert(successor.state))
+        {
+            return false;
+        }
+        Push(successor.state, static_cast<uint32_t>(node), successor.move);
+
+        // 積み損ねた状態からは手順を復元できないので、ゴールとしては扱わない
+        return successor.goal && !m_Arena.HasFailed();
+    }
+
+    // 最後の一手前の層から、メインピースをクリア位置に止める手をすべて数える
+    int CountSolutions(const size_t begin, const size_t end)
+    {
+        int count = 0;
+        int cells[GameState::MaxPieces];
+        for (size_t node = begin; node < end; ++node)
+        {
+            Unpack(m_States[node], cells);
+            count += IsGoalMove<0>(cells) + IsGoalMove<1>(cells) + IsGoalMove<2>(cells) + IsGoalMove<3>(cells);
+        }
+        return count;
+    }
+
+    template <int D>
+    int IsGoalMove(const int* cells)
+    {
+        const int to = Slide<D>(cells, 0);
+        return (to != cells[0] && m_Board.goals[to]) ? 1 : 0;
+    }
+
+    // サブピースは区別しないので、並べ替えて同一視する
+    void Normalize(int* cells) const
+    {
+        for (int i = 2; i < PieceCount(); ++i)
+        {
+            const int value = cells[i];
+            int j = i - 1;
+            while (j >= 1 && cells[j] > value)
+            {
+                cells[j + 1] = cells[j];
+                --j;
+            }
+            cells[j + 1] = value;
+        }
+    }
+
+    uint64_t Pack(const int* cells) const
+    {
+        uint64_t state = 0;
+        for (int index = 0; index < PieceCount(); ++index)
+        {
+            state |= static_cast<uint64_t>(cells[index]) << (index * Bits());
+        }
+        return state;
+    }
+
+    void Unpack(const uint64_t state, int* cells) const
+    {
+        const uint64_t mask = (1ull << Bits()) - 1;
+        for (int index = 0; index < PieceCount(); ++index)
+        {
+            cells[index] = static_cast<int>((state >> (index * Bits())) & mask);
+        }
+    }
+
+    void Push(const uint64_t state, const uint32_t parent, const uint8_t move)
+    {
+        m_States.PushBack(state);
+        m_Parents.PushBack(parent);
+        m_Moves.PushBack(move);
+    }
+
+    // 親をたどって手順を復元し、並べ替え前のピース番号に戻す（領域を確保できなければ false）
+    bool Reconstruct(const CellIndex* pieces, RouteFinder::Result& result) const
+    {
+        int length = 0;
+        for (size_t node = m_States.Size() - 1; node != 0; node = m_Parents[node])
+        {
+            ++length;
+        }
+
+        uint32_t* chain = m_Arena.AllocateArray<uint32_t>(length);
+        RouteFinder::Move* route = m_Arena.AllocateArray<RouteFinder::Move>(length);
+        if (length > 0 && (chain == nullptr || route == nullptr))
+        {
+            return false;
+        }
+
+        int depth = length;
+        for (size_t node = m_States.Size() - 1; node != 0; node = m_Parents[node])
+        {
+            chain[--depth] = static_cast<uint32_t>(node);
+        }
+
+        int current[GameState::MaxPieces];
+        for (int index = 0; index < PieceCount(); ++index)
+        {
+            current[index] = pieces[index];
+        }
+
+        int cells[GameState::MaxPieces];
+        for (int step = 0; step < length; ++step)
+        {
+            const uint32_t node = chain[step];
+            const int slot = m_Moves[node] >> 2, direction = m_Moves[node] & 3;
+            Unpack(m_States[m_Parents[node]], cells);
+
+            int to = cells[slot];
+            switch (direction)
+            {
+            case 0: to = Slide<0>(cells, slot); break;
+            case 1: to = Slide<1>(cells, slot); break;
+            case 2: to = Slide<2>(cells, slot); break;
+            case 3: to = Slide<3>(cells, slot); break;
+            }
+
+            for (int index = 0; index < PieceCount(); ++index)
+            {
+                if (current[index] == cells[slot])
+                {
+                    route[step] = RouteFinder::Move(index, static_cast<Field::Direction>(direction));
+                    current[index] = to;
+                    break;
+                }
+            }
+        }
+
+        result.solved = true;
+        result.moveCount = length;
+        result.route = route;
+        result.visitedStates = m_States.Size();
+        return true;
+    }
+
+private:
+    const SolverBoard& m_Board;
+    const int m_PieceCount;
+    const int m_Bits;
+    Arena& m_Arena;
+    SolverChunkPool m_Pool;
+    SolverStateTable m_Table;
+    SolverChunkedArray<uint64_t> m_States;
+    SolverChunkedArray<uint32_t> m_Parents;
+    SolverChunkedArray<uint8_t> m_Moves;
+};
+
+template <int W, int H, int N>
+bool SearchWith(const SolverBoard& board, const GameState& state, const RouteFinder::Parameter& param, Arena& arena, RouteFinder::Result& result)
+{
+    SolverKernel<W, H, N> kernel(board, state.pieceNum, arena);
+    result.specialized = SolverKernel<W, H, N>::IsSpecialized;
+    return kernel.Search(state.pieces, param, result);
+}
+
+bool SolverSearch(const SolverBoard& board, const GameState& state, const RouteFinder::Parameter& param, Arena& arena, RouteFinder::Result& result)
+{
+    bool found = false;
+
+    // よく使う盤面サイズは専用カーネルに振り分ける
+    if (param.kernel == RouteFinder::Kernel::Auto && SolverKernel<20, 20, 4>::Supports(board.width, board.height, state.pieceNum))
+    {
+        found = SearchWith<20, 20, 4>(board, state, param, arena, result);
+    }
+    else
+    {
+        found = SearchWith<0, 0, 0>(board, state, param, arena, result);
+    }
+
+    result.arenaBytes = arena.GetUsedBytes();
+    return found;
+}
+
+} // namespace
+
+RouteFinder::RouteFinder()
+    : m_Arena(256 * 1024, SolverRetainedBytes)
+    , m_Terrain()
+{
+
+}
+
+RouteFinder::~RouteFinder()
+{
+
+}
+
+bool RouteFinder::Find(const Field& field, const Parameter& param, Result& result)
+{
+    return Find(field, field.GetPieces(), param, result);
+}
+
+bool RouteFinder::Find(const Field& field, const std::vector<Field::Position>& pieces, const Parameter& param, Result& result)
+{
+    result = Result();
+
+    // 盤面ごとに地形を作り直すが、表の領域は前回のものを使い回す
+    GameState state;
+    m_Terrain.Reset(field);
+    if (!m_Terrain.CreateState(pieces, state))
+    {
+        return false;
+    }
+    return Find(m_Terrain, state, param, result);
+}
+
+bool RouteFinder::Find(const Terrain& terrain, const GameState& state, const Parameter& param, Result& result)
+{
+    result = Result();
+
+    if (!SolverKernel<0, 0, 0>::Supports(terrain.GetWidth(), terrain.GetHeight(), state.pieceNum))
+    {
+        return false;
+    }
+
+    // 前回の探索結果（手順を含む）はここで破棄される
+    m_Arena.Reset();
+
+    SolverBoard board;
+    board.Build(terrain);
+    return SolverSearch(board, state, param, m_Arena, result);
+}
+
+} // namespace game
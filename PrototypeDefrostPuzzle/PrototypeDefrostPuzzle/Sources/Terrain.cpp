@@ -0,0 +1,217 @@
+#include "Terrain.h"
+
+namespace game
+{
+
+constexpr uint8_t Terrain::UnreachableBound;
+
+Terrain::Terrain()
+    : m_Width(0)
+    , m_Height(0)
+    , m_Goal(0)
+    , m_Cells()
+    , m_Stops()
+    , m_Goals()
+    , m_ClearBounds()
+    , m_Queue()
+{
+
+}
+
+Terrain::Terrain(const Field& field)
+    : Terrain()
+{
+    Reset(field);
+}
+
+Terrain::~Terrain()
+{
+
+}
+
+void Terrain::Reset(const Field& field)
+{
+    m_Width = field.GetWidth();
+    m_Height = field.GetHeight();
+    m_Goal = MakeCellIndex(field.GetGoalPosition().x, field.GetGoalPosition().y, field.GetWidth());
+
+    // セル番号は 16bit に収める（InvalidCellIndex は使わない）
+    _ASSERT(m_Width * m_Height <= InvalidCellIndex);
+
+    const int cellCount = m_Width * m_Height;
+    const Field::ConstRow cells = field.GetCells();
+    m_Cells.assign(cells.begin(), cells.end());
+    for (auto& cell : m_Cells)
+    {
+        if (cell == Field::CellType::Piece)
+        {
+            cell = Field::CellType::Frozen;
+        }
+    }
+
+    // 隣のセルの停止位置を引き継ぐことで、一回の走査で全方向の停止位置を求める
+    m_Stops.resize(cellCount * 4);
+    const int up = static_cast<int>(Field::Direction::Up), left = static_cast<int>(Field::Direction::Left);
+    const int right = static_cast<int>(Field::Direction::Right), down = static_cast<int>(Field::Direction::Down);
+    for (int index = 0; index < cellCount; ++index)
+    {
+        const int x = index % m_Width, y = index / m_Width;
+        m_Stops[index * 4 + up] = static_cast<uint16_t>((y > 0 && IsWalkable(index - m_Width)) ? m_Stops[(index - m_Width) * 4 + up] : index);
+        m_Stops[index * 4 + left] = static_cast<uint16_t>((x > 0 && IsWalkable(index - 1)) ? m_Stops[(index - 1) * 4 + left] : index);
+    }
+    for (int index = cellCount - 1; index >= 0; --index)
+    {
+        const int x = index % m_Width, y = index / m_Width;
+        m_Stops[index * 4 + down] = static_cast<uint16_t>((y < m_Height - 1 && IsWalkable(index + m_Width)) ? m_Stops[(index + m_Width) * 4 + down] : index);
+        m_Stops[index * 4 + right] = static_cast<uint16_t>((x < m_Width - 1 && IsWalkable(index + 1)) ? m_Stops[(index + 1) * 4 + right] : index);
+    }
+
+    // ゲーム側の判定と同じく、ゴールとそれに隣接したセルで止まればクリア
+    m_Goals.assign(cellCount, 0);
+    if (cellCount > 0)
+    {
+        const int goalX = GetCellColumn(m_Goal, m_Width), goalY = GetCellRow(m_Goal, m_Width);
+        m_Goals[m_Goal] = 1;
+        if (goalX > 0) { m_Goals[m_Goal - 1] = 1; }
+        if (goalX < m_Width - 1) { m_Goals[m_Goal + 1] = 1; }
+        if (goalY > 0) { m_Goals[m_Goal - m_Width] = 1; }
+        if (goalY < m_Height - 1) { m_Goals[m_Goal + m_Width] = 1; }
+    }
+
+    // 止まれるクリア位置から、通れるセルを縦横にまっすぐたどって手数の下限を広げる
+    m_ClearBounds.assign(cellCount, UnreachableBound);
+    m_Queue.clear();
+    for (int index = 0; index < cellCount; ++index)
+    {
+        if (m_Goals[index] && IsWalkable(static_cast<CellIndex>(index)))
+        {
+            m_ClearBounds[index] = 0;
+            m_Queue.push_back(static_cast<CellIndex>(index));
+        }
+    }
+    for (size_t head = 0; head < m_Queue.size(); ++head)
+    {
+        const CellIndex cell = m_Queue[head];
+        const int bound = m_ClearBounds[cell] + 1;
+        if (bound >= UnreachableBound)
+        {
+            break;
+        }
+        for (int direction = 0; direction < static_cast<int>(Field::Direction::Num); ++direction)
+        {
+            const CellIndex stop = m_Stops[cell * 4 + direction];
+            const int step = direction == up ? -m_Width : direction == left ? -1 : direction == right ? 1 : m_Width;
+            for (int next = cell; next != stop; )
+            {
+                next += step;
+                if (m_ClearBounds[next] == UnreachableBound)
+                {
+                    m_ClearBounds[next] = static_cast<uint8_t>(bound);
+                    m_Queue.push_back(static_cast<CellIndex>(next));
+                }
+            }
+        }
+    }
+}
+
+bool Terrain::CreateState(const std::vector<Field::Position>& pieces, GameState& state) const
+{
+    state = GameState();
+    if (pieces.size() > GameState::MaxPieces)
+    {
+        return false;
+    }
+
+    for (const auto& piece : pieces)
+    {
+        if (piece.x < 0 || piece.y < 0 || piece.x >= m_Width || piece.y >= m_Height)
+        {
+            return false;
+        }
+        state.pieces[state.pieceNum++] = GetIndex(piece);
+    }
+    state.Rehash();
+    return true;
+}
+
+CellIndex Terrain::Slide(const GameState& state, const int piece, const Field::Direction direction) const
+{
+    const CellIndex from = state.pieces[piece];
+    int to = m_Stops[from * 4 + static_cast<int>(direction)];
+    if (to == from)
+    {
+        return from;
+    }
+
+    // 地形の停止位置までの間に他のピースがあれば、その手前で止まる
+    const bool vertical = direction == Field::Direction::Up || direction == Field::Direction::Down;
+    const bool forward = direction == Field::Direction::Right || direction == Field::Direction::Down;
+    const int step = vertical ? (forward ? m_Width : -m_Width) : (forward ? 1 : -1);
+    const int column = from % m_Width;
+    for (int other = 0; other < state.pieceNum; ++other)
+    {
+        const int position = state.pieces[other];
+        if (other == piece || (vertical && position % m_Width != column))
+        {
+            continue;
+        }
+        if (forward ? (position > from && position <= to) : (position < from && position >= to))
+        {
+            to = position - step;
+        }
+    }
+    return static_cast<CellIndex>(to);
+}
+
+bool Terrain::Move(GameState& state, const int piece, const Field::Direction direction) const
+{
+    const CellIndex to = Slide(state, piece, direction);
+    if (to == state.pieces[piece])
+    {
+        return false;
+    }
+
+    state.hash = Zobrist::MovePiece(state.hash, piece, state.pieces[piece], to);
+    state.pieces[piece] = to;
+    ++state.moveCount;
+    return true;
+}
+
+CellIndex Terrain::Slide(const GameState& state, const Occupancy& occupancy, const int piece, const Field::Direction direction) const
+{
+    const CellIndex from = state.pieces[piece];
+    const CellIndex stop = m_Stops[from * 4 + static_cast<int>(direction)];
+    if (stop == from)
+    {
+        return from;
+    }
+
+    // 地形の停止位置まで一つずつ進み、ピースがいればその手前で止まる
+    const bool vertical = direction == Field::Direction::Up || direction == Field::Direction::Down;
+    const bool forward = direction == Field::Direction::Right || direction == Field::Direction::Down;
+    const int step = vertical ? (forward ? m_Width : -m_Width) : (forward ? 1 : -1);
+    CellIndex cell = from;
+    while (cell != stop && !occupancy.Test(static_cast<CellIndex>(cell + step)))
+    {
+        cell = static_cast<CellIndex>(cell + step);
+    }
+    return cell;
+}
+
+bool Terrain::Move(GameState& state, Occupancy& occupancy, const int piece, const Field::Direction direction) const
+{
+    const CellIndex from = state.pieces[piece];
+    const CellIndex to = Slide(state, occupancy, piece, direction);
+    if (to == from)
+    {
+        return false;
+    }
+
+    occupancy.Move(from, to);
+    state.hash = Zobrist::MovePiece(state.hash, piece, from, to);
+    state.pieces[piece] = to;
+    ++state.moveCount;
+    return true;
+}
+
+} // namespace game
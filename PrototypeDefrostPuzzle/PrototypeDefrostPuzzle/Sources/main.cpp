@@ -1,33 +1,40 @@
 #include <iostream>
+#include <cstring>
+#include <random>
 #include "Field.h"
+#include "MeltSimulation.h"
 #include "Piece.h"
+#include "RouteFinder.h"
+#include "Terrain.h"
+#include "Benchmark.h"
+#include "LevelPipeline.h"
 
 namespace
 {
 
-void Dump(const game::Field::CellType** cells, const int width, const int height)
+void Dump(const game::Field& field)
 {
-    for (int y = 0; y < height; ++y)
+    for (const auto row : field.Rows())
     {
-        for (int x = 0; x < width; ++x)
+        for (const auto type : row)
         {
             const char* cell = nullptr;
-            switch (cells[y][x])
+            switch (type)
             {
             case game::Field::CellType::Frozen:
-                cell = "";
+                cell = "□";
                 break;
             case game::Field::CellType::Block:
-                cell = "";
+                cell = "■";
                 break;
             case game::Field::CellType::Piece:
-                cell = "";
+                cell = "○";
                 break;
             case game::Field::CellType::Goal:
-                cell = "";
+                cell = "◎";
                 break;
             default:
-                cell = "@";
+                cell = "　";
                 break;
             }
             std::cout << cell;
@@ -38,15 +45,65 @@ void Dump(const game::Field::CellType** cells, const int width, const int height
 
 }
 
-int main()
+int main(int argc, char** argv)
 {
+    if (argc > 1)
+    {
+        if (std::strcmp(argv[1], "bench-solver") == 0)
+        {
+            return prototype::Benchmark::SolverKernel(argc - 2, argv + 2);
+        }
+        if (std::strcmp(argv[1], "bench-field") == 0)
+        {
+            return prototype::Benchmark::FieldStorage(argc - 2, argv + 2);
+        }
+        if (std::strcmp(argv[1], "generate") == 0)
+        {
+            return prototype::LevelPipeline::Run(argc - 2, argv + 2);
+        }
+        if (std::strcmp(argv[1], "reverse") == 0)
+        {
+            return prototype::LevelPipeline::RunReverse(argc - 2, argv + 2);
+        }
+        if (std::strcmp(argv[1], "optimize") == 0)
+        {
+            return prototype::LevelPipeline::RunOptimize(argc - 2, argv + 2);
+        }
+        if (std::strcmp(argv[1], "dedup") == 0)
+        {
+            return prototype::LevelPipeline::RunDedup(argc - 2, argv + 2);
+        }
+        if (std::strcmp(argv[1], "cluster") == 0)
+        {
+            return prototype::LevelPipeline::RunCluster(argc - 2, argv + 2);
+        }
+        if (std::strcmp(argv[1], "pack") == 0)
+        {
+            return prototype::LevelPipeline::RunPack(argc - 2, argv + 2);
+        }
+        if (std::strcmp(argv[1], "pack-info") == 0)
+        {
+            return prototype::LevelPipeline::RunPackInfo(argc - 2, argv + 2);
+        }
+        if (std::strcmp(argv[1], "estimate") == 0)
+        {
+            return prototype::LevelPipeline::RunEstimate(argc - 2, argv + 2);
+        }
+        std::cerr << "unknown command: " << argv[1] << std::endl;
+        return 1;
+    }
+
     auto field = std::make_unique<game::Field>();
 
     game::Field::CreateParameter param;
-    field->Create(param);
-
+    param.seed = std::random_device{}();
+    std::cout << "seed: " << param.seed << std::endl;
     std::vector<game::Field::Position> positions;
-    field->PutPieces(positions, 4);
+    if (!field->Create(param) || !field->PutPieces(positions, 4))
+    {
+        std::cout << "cannot create field" << std::endl;
+        return 1;
+    }
 
     std::vector<Piece> pieces;
     for (auto& it : positions)
@@ -54,7 +111,40 @@ int main()
         pieces.push_back(Piece(it.x, it.y));
     }
 
-    field->Dump(Dump);
+    Dump(*field);
+
+    game::RouteFinder finder;
+    game::RouteFinder::Result result;
+    if (finder.Find(*field, game::RouteFinder::Parameter(), result))
+    {
+        std::cout << "moves: " << result.moveCount << std::endl;
+        for (int index = 0; index < result.moveCount; ++index)
+        {
+            std::cout << result.route[index].piece << static_cast<int>(result.route[index].direction);
+        }
+        std::cout << std::endl;
+
+        // 手順を GameState で打ち直し、通ったセルを溶かす
+        const game::Terrain terrain(*field);
+        game::GameState state;
+        game::MeltSimulation melt;
+        terrain.CreateState(field->GetPieces(), state);
+        melt.Reset(terrain);
+        int changedCells = 0;
+        for (int index = 0; index < result.moveCount; ++index)
+        {
+            const int piece = result.route[index].piece;
+            const game::CellIndex from = state.pieces[piece];
+            terrain.Move(state, piece, result.route[index].direction);
+            changedCells += static_cast<int>(melt.Step(from, state.pieces[piece]).size());
+        }
+        std::cout << "replay: " << (terrain.IsCleared(state) ? "cleared" : "not cleared") << " in " << state.moveCount << " moves" << std::endl;
+        std::cout << "melt: " << melt.GetMeltedNum() << " cells melted (" << changedCells << " changes)" << std::endl;
+    }
+    else
+    {
+        std::cout << "no route" << std::endl;
+    }
 
     std::string serialized, encoded;
     field->Serialize(serialized);
@@ -62,7 +152,7 @@ int main()
     std::cout << serialized << std::endl;
 
     field->CreateFromString(serialized.c_str());
-    field->Dump(Dump);
+    Dump(*field);
 
     return 0;
 }